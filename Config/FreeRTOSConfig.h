@@ -51,6 +51,13 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
   extern uint32_t SystemCoreClock;
+  extern void vOS2CleanUpTCB(void *tcb);
+  extern void vOS2TraceTaskCreate(void *tcb);
+  extern void vOS2TraceTaskDelete(void *tcb);
+  extern void vOS2SysTimerUpdate(void);
+  extern void vOS2SuppressTicksAndSleep(uint32_t xExpectedIdleTime);
+  extern void TimeBase_SleepEnter(void);
+  extern void TimeBase_SleepExit(void);
 #endif
 /*-------------------- STM32U5 specific defines -------------------*/
 #define configENABLE_TRUSTZONE                   0
@@ -62,8 +69,12 @@
 #define configUSE_PREEMPTION                     1
 #define configSUPPORT_STATIC_ALLOCATION          1
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
-#define configUSE_IDLE_HOOK                      0
+/* 1=the idle task zeroes freed memory pool blocks ahead of osMemoryPoolCAlloc.
+   The CMSIS-RTOS2 wrapper's default idle hook does the zeroing. */
+#define configOS2_MPOOL_PREZERO                  0
+#define configUSE_IDLE_HOOK                      configOS2_MPOOL_PREZERO
 #define configUSE_TICK_HOOK                      0
+#define configUSE_TICKLESS_IDLE                  2
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
@@ -76,6 +87,7 @@
 #define configQUEUE_REGISTRY_SIZE                8
 #define configUSE_RECURSIVE_MUTEXES              1
 #define configUSE_COUNTING_SEMAPHORES            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES    3
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
 /* Defaults to size_t for backward compatibility, but can be changed
@@ -148,6 +160,18 @@ header file. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* Let the CMSIS-RTOS2 wrapper release thread control blocks it keeps in slabs */
+#define portCLEAN_UP_TCB( pxTCB )               vOS2CleanUpTCB( pxTCB )
+/* Keep the CMSIS-RTOS2 wrapper's thread registry up to date for osThreadEnumerate */
+#define traceTASK_CREATE( pxNewTCB )            vOS2TraceTaskCreate( pxNewTCB )
+#define traceTASK_DELETE( pxTCB )               vOS2TraceTaskDelete( pxTCB )
+/* Let the CMSIS-RTOS2 wrapper track wraps of its 64-bit system timer every tick */
+#define traceTASK_INCREMENT_TICK( xTickCount )  vOS2SysTimerUpdate()
+/* Sleep through idle ticks: the CMSIS-RTOS2 wrapper reloads SysTick to wake when the next thread is due */
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )   vOS2SuppressTicksAndSleep( xExpectedIdleTime )
+/* Stop the HAL's TIM6 tick while asleep, and bring the HAL tick up to date on waking */
+#define configPRE_SLEEP_PROCESSING( xExpectedIdleTime )     TimeBase_SleepEnter()
+#define configPOST_SLEEP_PROCESSING( xExpectedIdleTime )    TimeBase_SleepExit()
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,51 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+
+#include <stdint.h>
+
+
+#define     BENCH_START_DELAY_MS        2000
+#define     BENCH_TASK_STACK_SIZE_B     3072
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Accumulated cycle counts for one measured operation
+ */
+typedef struct {
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    total;
+    uint32_t    count;
+} bench_stats_t;
+
+
+void benchmark_start_task(void);
+
+void bench_stats_reset(bench_stats_t* stats);
+void bench_stats_add(bench_stats_t* stats, uint32_t cycles);
+void bench_stats_report(const char* name, const bench_stats_t* stats);
+
+void bench_run_in_isr(void (*job)(void));
+void bench_tick_isr(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* BENCHMARK_H */
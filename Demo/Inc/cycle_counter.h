@@ -0,0 +1,52 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+
+#include <stdint.h>
+#include "stm32u5xx_hal.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Start the DWT cycle counter. Safe to call more than once.
+ */
+static inline void cycle_counter_init(void) {
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/**
+ * @brief Read the DWT cycle counter. This wraps every 2^32 core clocks.
+ *
+ * @retval The current cycle count.
+ */
+static inline uint32_t cycle_counter_read(void) {
+
+    return DWT->CYCCNT;
+}
+
+
+uint64_t cycle_counter_read64(void);
+uint64_t cycle_counter_to_us(uint64_t cycles);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* CYCLE_COUNTER_H */
@@ -0,0 +1,45 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+
+#include <stdarg.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A small, allocation-free printf() subset for log messages:
+ *
+ *   - Conversions: %d %i %u %x %X %c %s %p %%
+ *   - Flags: '-' (left justify), '0' (zero pad), '+' and ' ' (sign of
+ *     %d and %i), '#' (0x prefix for %x and %X)
+ *   - Width as digits or '*'; precision for %s only, as digits or '*'
+ *   - Length modifiers: hh h l ll j z t
+ *
+ * Floating point conversions consume their argument and print '?'.
+ * Output is truncated to fit, and is always NUL terminated. As with
+ * snprintf(), the untruncated length is returned, so a result of `size` or
+ * more means the message was cut short.
+ */
+uint32_t log_format(char* buffer, uint32_t size, const char* format_string, ...) __attribute__((format(printf, 3, 4)));
+uint32_t log_vformat(char* buffer, uint32_t size, const char* format_string, va_list args);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LOG_FORMAT_H */
@@ -0,0 +1,314 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef LOGGING_H
+#define LOGGING_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Set by CMake: 1 to send binary records rather than formatted text
+#ifndef LOG_DEFERRED_FORMAT
+#define     LOG_DEFERRED_FORMAT         0
+#endif
+
+// Message levels. Set by CMake: calls below LOG_LEVEL are removed by the
+// preprocessor, format strings and arguments included
+#define     LOG_LEVEL_TRACE             0
+#define     LOG_LEVEL_DEBUG             1
+#define     LOG_LEVEL_INFO              2
+#define     LOG_LEVEL_WARN              3
+#define     LOG_LEVEL_ERROR             4
+#define     LOG_LEVEL_NONE              5
+
+#ifndef LOG_LEVEL
+#define     LOG_LEVEL                   LOG_LEVEL_DEBUG
+#endif
+
+#define     LOG_BUFFER_SIZE_B           5120
+#define     LOG_MESSAGE_MAX_LEN_B       1024
+#define     LOG_RECORD_MAX_LEN_B        128
+
+// Number of message slots in the logger task's queue -- must be a power of two
+#define     LOG_QUEUE_DEPTH             8
+#define     LOG_TASK_STACK_SIZE_B       2048
+
+// Logger thread batching: queued messages are packed, newline-separated,
+// into one mvServerLog() call of up to LOG_BATCH_MAX_B bytes. A batch is
+// sent when full, when its oldest message is LOG_BATCH_DEADLINE_MS old, or
+// straight after an error message
+#define     LOG_BATCH_MAX_B             1024
+#define     LOG_BATCH_DEADLINE_MS       50
+
+// Per-call-site flood control. Each server_log()/server_error() call site
+// has a token bucket holding up to LOG_RATE_LIMIT_BURST messages, refilled
+// at LOG_RATE_LIMIT_PER_SEC; set LOG_RATE_LIMIT_BURST to 0 to disable it.
+// With LOG_REPEAT_SUPPRESSION, identical consecutive messages from a site
+// are counted, not sent, and reported when the site next logs something
+// different, or every LOG_REPEAT_SUMMARY_MS while the repeats continue
+#define     LOG_RATE_LIMIT_BURST        20
+#define     LOG_RATE_LIMIT_PER_SEC      10
+#define     LOG_REPEAT_SUPPRESSION      1
+#define     LOG_REPEAT_SUMMARY_MS       10000
+
+// mvServerLog() latency histogram: bucket 0 counts calls under
+// LOG_LATENCY_MIN_US, each later bucket doubles the limit, and the last
+// bucket counts everything slower
+#define     LOG_LATENCY_BUCKETS         8
+#define     LOG_LATENCY_MIN_US          32
+
+// Interrupt-context records: one ring per NVIC priority level, plus one
+// for thread-mode callers. Depth must be a power of two
+#define     LOG_ISR_PRIORITY_LEVELS     16
+#define     LOG_ISR_RING_DEPTH          8
+#define     LOG_ISR_ARGS_MAX            3
+#define     LOG_ISR_POLL_MS             100
+
+#if LOG_DEFERRED_FORMAT
+#define     LOG_SLOT_SIZE_B             LOG_RECORD_MAX_LEN_B
+#else
+#define     LOG_SLOT_SIZE_B             LOG_MESSAGE_MAX_LEN_B
+#endif
+
+// Deferred record argument types
+#define     LOG_ARG_U32                 0
+#define     LOG_ARG_U64                 1
+#define     LOG_ARG_DOUBLE              2
+#define     LOG_ARG_STRING              3
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Logging pipeline statistics
+ */
+typedef struct {
+    uint32_t    syscalls;       // mvServerLog() calls made
+    uint32_t    messages;       // Messages those calls carried
+    uint32_t    bytes;          // Bytes those calls carried
+    uint32_t    submitted;      // Messages handed to the pipeline
+    uint32_t    dropped;        // ...of which lost to a full queue or ring
+    uint32_t    truncated;      // ...of which cut short to fit a slot or record
+    uint32_t    suppressed;     // Messages stopped by rate limiting or as repeats
+    uint32_t    latency_max_us; // Slowest mvServerLog() call
+    uint32_t    latency[LOG_LATENCY_BUCKETS];
+} log_stats_t;
+
+
+/*
+ * Flood control state for one log call site
+ */
+typedef struct {
+    uint32_t    debt;           // Rate limit: messages owed to the bucket, x1000
+    uint32_t    last_tick;      // Rate limit: when `debt` was last paid down
+    uint32_t    last_hash;      // Repeats: hash of the last message sent
+    uint32_t    summary_tick;   // Repeats: when the last summary was sent
+    uint16_t    repeats;        // Messages suppressed as repeats since then
+    uint16_t    rate_limited;   // Messages suppressed by the rate limit since then
+    bool        has_hash;
+} log_site_t;
+
+#if (LOG_RATE_LIMIT_BURST > 0) || LOG_REPEAT_SUPPRESSION
+#define LOG_SITE()                      ({ static log_site_t log_site_; &log_site_; })
+#else
+#define LOG_SITE()                      NULL
+#endif
+
+
+void log_init(void);
+void log_start_task(void);
+void log_set_async(bool is_async);
+void log_set_batching(bool is_batching);
+void log_get_stats(log_stats_t* stats);
+void log_report_health(void);
+void log_isr_post(const char* format_string, uint32_t arg_count, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+
+/*
+ * Log from an interrupt handler. The record -- format string, up to three
+ * integer arguments and a cycle count timestamp -- is copied into a ring
+ * owned by the current interrupt priority, so no locking, formatting or
+ * kernel calls are needed. The logger thread formats and sends it later.
+ * The format string must be a string literal, and `%s` is not supported.
+ */
+#define server_log_from_isr(format_string, ...) \
+    LOG_CONCAT(LOG_ISR_POST_, LOG_NARGS(__VA_ARGS__))(LOG_FORMAT_ID(format_string), ##__VA_ARGS__)
+
+#define LOG_ISR_POST_0(f)               log_isr_post(f, 0, 0, 0, 0)
+#define LOG_ISR_POST_1(f, a)            log_isr_post(f, 1, (uint32_t)(a), 0, 0)
+#define LOG_ISR_POST_2(f, a, b)         log_isr_post(f, 2, (uint32_t)(a), (uint32_t)(b), 0)
+#define LOG_ISR_POST_3(f, a, b, c)      log_isr_post(f, 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+
+// Count up to eight macro arguments, and paste tokens after expansion
+#define LOG_NARGS(...)                  LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define LOG_CONCAT(a, b)                LOG_CONCAT_(a, b)
+#define LOG_CONCAT_(a, b)               a##b
+
+
+#if LOG_DEFERRED_FORMAT
+
+/*
+ * A deferred log record under construction: a flags byte, the format
+ * string's ID, a 64-bit cycle count timestamp and then the encoded arguments
+ */
+typedef struct {
+    log_site_t* site;
+    const char* format_id;
+    uint16_t    length;
+    uint16_t    args_start;
+    bool        is_truncated;
+    bool        is_suppressed;
+    uint8_t     data[LOG_RECORD_MAX_LEN_B];
+} log_record_t;
+
+void log_record_begin(log_record_t* record, log_site_t* site, bool is_err, const char* format_id);
+void log_record_put(log_record_t* record, uint32_t arg_type, uint64_t int_value, double float_value, const void* string_value);
+void log_record_post(log_record_t* record);
+
+/*
+ * Deferred logging. Each call site's format string is placed in the
+ * non-loaded `.log_fmt` section, so it costs no flash. Its address in that
+ * section is the message ID, and the arguments follow as raw values. The
+ * section flags are injected through the section name; the trailing `@`
+ * starts an assembler comment that swallows the flags GCC would add.
+ * `tools/log_decode.py` turns the records back into text using the .elf.
+ *
+ * The format string must be a string literal. Up to eight arguments are
+ * supported; strings are copied into the record, other pointers are sent
+ * as their value.
+ */
+#define     LOG_FMT_SECTION             ".log_fmt,\"\",%progbits @"
+
+#define LOG_FORMAT_ID(format_string) \
+    ({ static const char log_fmt_[] __attribute__((section(LOG_FMT_SECTION), used)) = format_string; log_fmt_; })
+
+#define server_log(format_string, ...)      LOG_DEFERRED(false, format_string, ##__VA_ARGS__)
+#define server_error(format_string, ...)    LOG_DEFERRED(true, format_string, ##__VA_ARGS__)
+
+#define LOG_DEFERRED(is_err, format_string, ...) \
+    do { \
+        log_record_t log_record_; \
+        log_record_begin(&log_record_, LOG_SITE(), is_err, LOG_FORMAT_ID(format_string)); \
+        LOG_PUT_ARGS(&log_record_, ##__VA_ARGS__) \
+        log_record_post(&log_record_); \
+    } while (0)
+
+// Classify an argument and pass it to log_record_put(). Each _Generic branch
+// is valid for every argument type, and the value is evaluated once
+#define LOG_PUT(record, arg) \
+    do { \
+        __auto_type log_arg_ = (arg); \
+        log_record_put(record, LOG_ARG_TYPE(log_arg_), LOG_ARG_INT(log_arg_), \
+                       LOG_ARG_FLOAT(log_arg_), LOG_ARG_STRING_PTR(log_arg_)); \
+    } while (0);
+
+#define LOG_ARG_TYPE(x) _Generic((x), \
+    char*: LOG_ARG_STRING, const char*: LOG_ARG_STRING, \
+    signed char*: LOG_ARG_STRING, const signed char*: LOG_ARG_STRING, \
+    unsigned char*: LOG_ARG_STRING, const unsigned char*: LOG_ARG_STRING, \
+    float: LOG_ARG_DOUBLE, double: LOG_ARG_DOUBLE, \
+    long long: LOG_ARG_U64, unsigned long long: LOG_ARG_U64, \
+    default: LOG_ARG_U32)
+
+#define LOG_ARG_INT(x) _Generic((x), \
+    long long: (x), unsigned long long: (x), \
+    float: 0, double: 0, \
+    default: (uintptr_t)(x))
+
+#define LOG_ARG_FLOAT(x) _Generic((x), \
+    float: (x), double: (x), \
+    default: 0.0)
+
+#define LOG_ARG_STRING_PTR(x) _Generic((x), \
+    char*: (x), const char*: (x), \
+    signed char*: (x), const signed char*: (x), \
+    unsigned char*: (x), const unsigned char*: (x), \
+    default: NULL)
+
+// Apply LOG_PUT() to each of up to eight arguments
+#define LOG_PUT_ARGS(record, ...)       LOG_CONCAT(LOG_PUT_, LOG_NARGS(__VA_ARGS__))(record, ##__VA_ARGS__)
+
+#define LOG_PUT_0(r)
+#define LOG_PUT_1(r, a)                 LOG_PUT(r, a)
+#define LOG_PUT_2(r, a, ...)            LOG_PUT(r, a) LOG_PUT_1(r, __VA_ARGS__)
+#define LOG_PUT_3(r, a, ...)            LOG_PUT(r, a) LOG_PUT_2(r, __VA_ARGS__)
+#define LOG_PUT_4(r, a, ...)            LOG_PUT(r, a) LOG_PUT_3(r, __VA_ARGS__)
+#define LOG_PUT_5(r, a, ...)            LOG_PUT(r, a) LOG_PUT_4(r, __VA_ARGS__)
+#define LOG_PUT_6(r, a, ...)            LOG_PUT(r, a) LOG_PUT_5(r, __VA_ARGS__)
+#define LOG_PUT_7(r, a, ...)            LOG_PUT(r, a) LOG_PUT_6(r, __VA_ARGS__)
+#define LOG_PUT_8(r, a, ...)            LOG_PUT(r, a) LOG_PUT_7(r, __VA_ARGS__)
+
+#else
+
+#define LOG_FORMAT_ID(format_string)    (format_string)
+
+#define server_log(format_string, ...)      log_text(LOG_SITE(), false, format_string, ##__VA_ARGS__)
+#define server_error(format_string, ...)    log_text(LOG_SITE(), true, format_string, ##__VA_ARGS__)
+
+void log_text(log_site_t* site, bool is_err, const char* format_string, ...);
+
+#endif /* LOG_DEFERRED_FORMAT */
+
+
+/*
+ * Leveled logging. Each macro is a `server_log()` or `server_error()` call
+ * when its level is at or above LOG_LEVEL, and nothing at all otherwise.
+ * A removed call only appears inside `sizeof`, so its arguments are still
+ * type checked and count as used, but they are not evaluated and the format
+ * string is not emitted; arguments must not have side effects the program
+ * relies on. The format string must be a string literal, as the level tag
+ * is prepended at compile time.
+ */
+int log_removed(const char* format_string, ...) __attribute__((format(printf, 1, 2)));
+
+#define LOG_REMOVED(format_string, ...) ((void)sizeof(log_removed(format_string, ##__VA_ARGS__)))
+
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
+#define log_trace(format_string, ...)   server_log("[TRACE] " format_string, ##__VA_ARGS__)
+#else
+#define log_trace(format_string, ...)   LOG_REMOVED(format_string, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define log_debug(format_string, ...)   server_log("[DEBUG] " format_string, ##__VA_ARGS__)
+#else
+#define log_debug(format_string, ...)   LOG_REMOVED(format_string, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define log_info(format_string, ...)    server_log(format_string, ##__VA_ARGS__)
+#else
+#define log_info(format_string, ...)    LOG_REMOVED(format_string, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define log_warn(format_string, ...)    server_log("[WARN] " format_string, ##__VA_ARGS__)
+#else
+#define log_warn(format_string, ...)    LOG_REMOVED(format_string, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define log_error(format_string, ...)   server_error(format_string, ##__VA_ARGS__)
+#else
+#define log_error(format_string, ...)   LOG_REMOVED(format_string, ##__VA_ARGS__)
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LOGGING_H */
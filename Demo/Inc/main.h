@@ -10,11 +10,15 @@
 #define MAIN_H
 
 
+#include "logging.h"
+
+
 #define     PING_PAUSE_MS               5000
 #define     LED_PAUSE_MS                1000
-
-#define     LOG_BUFFER_SIZE_B           5120
-#define     LOG_MESSAGE_MAX_LEN_B       1024
+// Log the logging pipeline's health every this many pings
+#define     HEALTH_REPORT_PINGS         12
+// Logging formats straight into the logger's queue, so callers need little stack
+#define     PING_TASK_STACK_SIZE_B      1024
 
 
 #ifdef __cplusplus
@@ -23,8 +27,6 @@ extern "C" {
 
 
 void Error_Handler(void);
-void server_log(const char* format_string, ...);
-void server_error(const char* format_string, ...);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,60 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Release timing statistics for one periodic job
+ */
+typedef struct {
+    uint32_t    releases;           // Periods the job has run
+    uint32_t    overruns;           // ...of which ran past the next release
+    uint32_t    skipped;            // Releases dropped to get back on schedule
+    uint32_t    lateness_max_ticks; // Latest start after a scheduled release
+    uint32_t    lateness_total_ticks;
+    uint32_t    jitter_max_us;      // Largest deviation between two starts and the period
+    uint32_t    jitter_total_us;
+} periodic_stats_t;
+
+
+/*
+ * A job released at fixed multiples of its period. Set up with
+ * `periodic_init()`; only the thread running the job calls `periodic_wait()`
+ */
+typedef struct {
+    uint32_t            period_ticks;
+    uint32_t            period_us;
+    uint32_t            release_tick;   // Kernel tick of the current release
+    uint64_t            start_cycles;   // When the current release started running
+    periodic_stats_t    stats;
+} periodic_job_t;
+
+
+void periodic_init(periodic_job_t* job, uint32_t period_ms);
+bool periodic_wait(periodic_job_t* job);
+void periodic_get_stats(const periodic_job_t* job, periodic_stats_t* stats);
+void periodic_report(const char* name, const periodic_job_t* job);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* PERIODIC_H */
@@ -0,0 +1,1626 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+// Microvisor + HAL
+#include "cmsis_os.h"
+#include "semphr.h"
+#include "event_groups.h"
+// Application
+#include "main.h"
+#include "benchmark.h"
+#include "cycle_counter.h"
+#include "periodic.h"
+
+
+/*
+ * PRIVATE DEFINITIONS
+ */
+#define     BENCH_LOG_ITERATIONS        32
+#define     BENCH_LOG_DRAIN_MS          1000
+#define     BENCH_LOG_BURSTS            4
+#define     BENCH_LOG_SUPPRESSED_CALLS  64
+#define     BENCH_MQ_DEPTH              32
+#define     BENCH_MQ_BACKLOG_STEP       8
+#define     BENCH_MQ_ITERATIONS         16
+#define     BENCH_MQ_PRIO_LOW           0
+#define     BENCH_MQ_PRIO_HIGH          255
+#define     BENCH_MAIL_DEPTH            4
+#define     BENCH_MAIL_MAX_SIZE_B       1024
+#define     BENCH_MAIL_ITERATIONS       64
+#define     BENCH_POOL_BLOCKS           8
+#define     BENCH_POOL_BLOCK_SIZE_B     32
+#define     BENCH_POOL_ITERATIONS       64
+#define     BENCH_CB_ITERATIONS         16
+#define     BENCH_CB_CHURN_ROUNDS       8
+#define     BENCH_CB_KEEP_SIZE_B        16
+#define     BENCH_CB_STACK_SIZE_B       256
+#define     BENCH_ENUM_ITERATIONS       16
+#define     BENCH_ENUM_CHUNK            4
+#define     BENCH_FLAGS_PRODUCERS       8
+#define     BENCH_FLAGS_ROUNDS          32
+#define     BENCH_FLAGS_STACK_SIZE_B    512
+#define     BENCH_TIMER_ITERATIONS      64
+#define     BENCH_PERIODIC_ITERATIONS   16
+#define     BENCH_PERIODIC_PERIOD_MS    10
+#define     BENCH_PERIODIC_BODY_US      3000
+#define     BENCH_IDLE_WINDOW_MS        2000
+#define     BENCH_EF_ROUNDS             16
+#define     BENCH_EF_FLAG               0x01U
+#define     BENCH_EF_LOAD_US            1000
+#define     BENCH_EF_STACK_SIZE_B       512
+#define     BENCH_MW_DEPTH              4
+#define     BENCH_MW_MAILS              64
+#define     BENCH_MW_MAIL_SIZE_B        16
+#define     BENCH_MW_CONSUME_MS         5
+#define     BENCH_MW_DONE_FLAG          0x01U
+#define     BENCH_MW_STACK_SIZE_B       512
+#define     BENCH_API_DEPTH             4
+#define     BENCH_API_ITERATIONS        64
+#define     BENCH_API_SIGNAL            0x01
+
+
+/*
+ * PRIVATE TYPES
+ */
+// A memory pool managed the way osMemoryPoolAlloc()/osMemoryPoolFree() used
+// to: a counting semaphore plus a free list guarded by a critical section
+typedef struct {
+    void*               head;
+    SemaphoreHandle_t   sem;
+    StaticSemaphore_t   sem_cb;
+} bench_locked_pool_t;
+
+// The RTOS objects whose control blocks the CMSIS-RTOS2 layer takes from slabs
+typedef enum {
+    BENCH_CB_MUTEX = 0,
+    BENCH_CB_SEMAPHORE,
+    BENCH_CB_EVENT_FLAGS,
+    BENCH_CB_TIMER,
+    BENCH_CB_THREAD,
+    BENCH_CB_KINDS
+} bench_cb_kind_t;
+
+// Operations timed through both the CMSIS-RTOS v1 and RTOS2 APIs
+typedef enum {
+    BENCH_API_MESSAGE = 0,
+    BENCH_API_POOL,
+    BENCH_API_MAIL,
+    BENCH_API_SEMAPHORE,
+    BENCH_API_SIGNAL_OP,
+    BENCH_API_OPS
+} bench_api_op_t;
+
+// Block and mail size for the API comparison
+typedef struct {
+    uint32_t    words[4];
+} bench_api_item_t;
+
+
+/*
+ * PRIVATE FUNCTION PROTOTYPES
+ */
+static void start_bench_task(void *argument);
+static void bench_log_caller_latency(bool is_async, bench_stats_t* stats);
+static void bench_log_batching(bool is_batching);
+static void bench_log_suppressed(bench_stats_t* repeat_stats, bench_stats_t* limited_stats);
+static void bench_log_levels(void);
+static void bench_mq_priority(void);
+static void bench_mail_throughput(uint32_t size);
+static uint32_t bench_kb_per_s(uint32_t size, const bench_stats_t* stats);
+static void bench_pool(void);
+static void bench_pool_job(void);
+static void* bench_locked_alloc(bench_locked_pool_t* pool);
+static void bench_locked_free(bench_locked_pool_t* pool, void* block);
+static void bench_control_blocks(void);
+static void bench_cb_churn(bool use_slab);
+static void* bench_cb_create(bench_cb_kind_t kind, bool use_slab);
+static void bench_cb_delete(bench_cb_kind_t kind, bool use_slab, void* handle);
+static void bench_cb_idle(void* argument);
+static void bench_cb_timer(void* argument);
+static void bench_cb_heap_timer(TimerHandle_t timer);
+static void bench_thread_enumerate(void);
+static void bench_flags_wait_all(bool is_notify_loop);
+static void bench_flags_consumer(void* argument);
+static void bench_sys_timer(void);
+static void bench_sys_timer_job(void);
+static uint32_t bench_sys_timer_masked(void);
+static void bench_periodic(bool is_periodic_job);
+static void bench_tickless_idle(void);
+static void bench_event_flags_latency(bool is_direct);
+static void bench_ef_waiter(void* argument);
+static void bench_ef_load(void* argument);
+static void bench_ef_set_job(void);
+static void bench_mail_alloc_wait(bool is_blocking);
+static void bench_mw_consumer(void* argument);
+static void bench_api(bool is_v1);
+
+
+/*
+ * GLOBALS
+ */
+static StaticTask_t bench_task_cb;
+static uint64_t     bench_task_stack[BENCH_TASK_STACK_SIZE_B / sizeof(uint64_t)];
+static const osThreadAttr_t bench_task_attributes = {
+    .name = "Bench Task",
+    .priority = osPriorityBelowNormal,
+    .cb_mem = &bench_task_cb,
+    .cb_size = sizeof(bench_task_cb),
+    .stack_mem = bench_task_stack,
+    .stack_size = sizeof(bench_task_stack)
+};
+
+static StaticMessageQueue_t bench_mq_cb;
+static uint32_t             bench_mq_mem[MQUEUE_ARR_SIZE(BENCH_MQ_DEPTH, sizeof(uint32_t)) / sizeof(uint32_t)];
+static const osMessageQueueAttr_t bench_mq_attributes = {
+    .name = "Bench Queue",
+    .cb_mem = &bench_mq_cb,
+    .cb_size = sizeof(bench_mq_cb),
+    .mq_mem = bench_mq_mem,
+    .mq_size = sizeof(bench_mq_mem)
+};
+
+static StaticMessageQueue_t bench_copy_cb;
+static uint32_t             bench_copy_mem[MQUEUE_ARR_SIZE(BENCH_MAIL_DEPTH, BENCH_MAIL_MAX_SIZE_B) / sizeof(uint32_t)];
+static StaticMailQueue_t    bench_mail_cb;
+static uint32_t             bench_mail_mp_mem[MAILQ_MP_SIZE(BENCH_MAIL_DEPTH, BENCH_MAIL_MAX_SIZE_B) / sizeof(uint32_t)];
+static uint32_t             bench_mail_mq_mem[MAILQ_MQ_SIZE(BENCH_MAIL_DEPTH) / sizeof(uint32_t)];
+static uint32_t             bench_frame_in[BENCH_MAIL_MAX_SIZE_B / sizeof(uint32_t)];
+static uint32_t             bench_frame_out[BENCH_MAIL_MAX_SIZE_B / sizeof(uint32_t)];
+
+static StaticMemPool_t      bench_pool_cb;
+static uint32_t             bench_pool_mem[MEMPOOL_ARR_SIZE(BENCH_POOL_BLOCKS, BENCH_POOL_BLOCK_SIZE_B) / sizeof(uint32_t)];
+static osMemoryPoolId_t     bench_pool_id;
+static bench_locked_pool_t  bench_locked_pool;
+static uint32_t             bench_locked_mem[MEMPOOL_ARR_SIZE(BENCH_POOL_BLOCKS, BENCH_POOL_BLOCK_SIZE_B) / sizeof(uint32_t)];
+static bench_stats_t        bench_pool_stats[2];
+
+static volatile uint32_t    bench_flags_start;
+static volatile uint32_t    bench_flags_wakeups;
+static bench_stats_t        bench_flags_stats;
+static bench_stats_t        bench_timer_stats[3];
+static uint32_t             bench_timer_backwards;
+
+static EventGroupHandle_t   bench_ef_group;
+static osEventFlagsId_t     bench_ef_id;
+static volatile bool        bench_ef_is_direct;
+static volatile bool        bench_ef_is_loaded;
+static volatile uint32_t    bench_ef_start;
+static bench_stats_t        bench_ef_stats;
+
+static osMailQueueId_t      bench_mw_queue;
+static osThreadId_t         bench_mw_producer;
+
+osMessageQDef(bench_v1_queue, BENCH_API_DEPTH, uint32_t);
+osPoolDef(bench_v1_pool, BENCH_API_DEPTH, bench_api_item_t);
+osMailQDef(bench_v1_mail, BENCH_API_DEPTH, bench_api_item_t);
+osSemaphoreDef(bench_v1_semaphore);
+
+static const char* const    bench_api_v1_names[BENCH_API_OPS] = {
+    "v1 osMessagePut+Get", "v1 osPoolAlloc+Free", "v1 osMailAlloc+Put+Get+Free",
+    "v1 osSemaphoreWait+Release", "v1 osSignalSet+Wait"
+};
+static const char* const    bench_api_v2_names[BENCH_API_OPS] = {
+    "v2 osMessageQueuePut+Get", "v2 osMemoryPoolAlloc+Free", "v2 osMailQueueAlloc+Put+Get+Free",
+    "v2 osSemaphoreAcquire+Release", "v2 osThreadFlagsSet+Wait"
+};
+
+static const char* const    bench_cb_names[BENCH_CB_KINDS] = {
+    "mutex", "semaphore", "event flags", "timer", "thread"
+};
+
+// Job for the next timer interrupt to run -- see bench_run_in_isr()
+static void (* volatile bench_isr_job)(void) = NULL;
+
+
+/**
+ * @brief Create the one-shot benchmark thread.
+ */
+void benchmark_start_task(void) {
+
+    osThreadNew(start_bench_task, NULL, &bench_task_attributes);
+}
+
+
+/**
+ * @brief Clear a set of benchmark results.
+ *
+ * @param stats The results to clear.
+ */
+void bench_stats_reset(bench_stats_t* stats) {
+
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+    stats->total = 0;
+    stats->count = 0;
+}
+
+
+/**
+ * @brief Add one measurement to a set of benchmark results.
+ *
+ * @param stats  The results to update.
+ * @param cycles The measured duration in core clock cycles.
+ */
+void bench_stats_add(bench_stats_t* stats, uint32_t cycles) {
+
+    if (cycles < stats->min) stats->min = cycles;
+    if (cycles > stats->max) stats->max = cycles;
+    stats->total += cycles;
+    stats->count++;
+}
+
+
+/**
+ * @brief Log a set of benchmark results.
+ *
+ * @param name  The name of the measured operation.
+ * @param stats The results to log.
+ */
+void bench_stats_report(const char* name, const bench_stats_t* stats) {
+
+    if (stats->count == 0) {
+        server_log("[BENCH] %s: no samples", name);
+        return;
+    }
+
+    server_log("[BENCH] %s: min %lu avg %lu max %lu cycles (n=%lu)", name,
+               (unsigned long)stats->min,
+               (unsigned long)(stats->total / stats->count),
+               (unsigned long)stats->max,
+               (unsigned long)stats->count);
+}
+
+
+/**
+ * @brief Run a job in interrupt context, from the next HAL tick interrupt,
+ *        and wait for it to finish.
+ *
+ * @param job The function to run.
+ */
+void bench_run_in_isr(void (*job)(void)) {
+
+    bench_isr_job = job;
+    while (bench_isr_job != NULL) {
+        osDelay(1);
+    }
+}
+
+
+/**
+ * @brief Called from the HAL tick interrupt: run the pending job, if any.
+ */
+void bench_tick_isr(void) {
+
+    void (*job)(void) = bench_isr_job;
+    if (job != NULL) {
+        job();
+        bench_isr_job = NULL;
+    }
+}
+
+
+/**
+ * @brief Function implementing the benchmark thread. Runs each benchmark
+ *        once, logs the results and exits.
+ *
+ * @param argument: Not used.
+ */
+static void start_bench_task(void *argument) {
+
+    bench_stats_t sync_stats, async_stats;
+
+    // Let the demo tasks and the logger settle first
+    osDelay(BENCH_START_DELAY_MS);
+    cycle_counter_init();
+
+    // Caller-side cost of server_log(), in place vs. handed to the logger thread
+    bench_log_caller_latency(false, &sync_stats);
+    bench_log_caller_latency(true, &async_stats);
+    bench_stats_report("server_log (in place)", &sync_stats);
+    bench_stats_report("server_log (logger thread)", &async_stats);
+
+    // System calls needed for bursty logging, with and without batching
+    bench_log_batching(false);
+    bench_log_batching(true);
+
+    // Caller-side cost of messages dropped by flood control
+    bench_stats_t repeat_stats, limited_stats;
+    bench_log_suppressed(&repeat_stats, &limited_stats);
+    bench_stats_report("server_log (repeat suppressed)", &repeat_stats);
+    bench_stats_report("server_log (rate limited)", &limited_stats);
+
+    // Caller-side cost of each log level in this build
+    bench_log_levels();
+
+    // Delivery time of an urgent message behind a growing low-priority backlog
+    bench_mq_priority();
+
+    // Moving frames between tasks: copied through a message queue vs. passed by pointer
+    bench_mail_throughput(16);
+    bench_mail_throughput(256);
+    bench_mail_throughput(BENCH_MAIL_MAX_SIZE_B);
+
+    // Non-blocking pool allocation: lock-free vs. semaphore and critical section
+    bench_pool();
+
+    // Creating and deleting RTOS objects: heap control blocks vs. slabs
+    bench_control_blocks();
+
+    // Listing threads: scheduler-suspended heap snapshot vs. chunked registry walk
+    bench_thread_enumerate();
+
+    // Waiting for eight flags, each set separately: woken per flag vs. once
+    bench_flags_wait_all(true);
+    bench_flags_wait_all(false);
+
+    // Reading the system timer: 32-bit with interrupts masked vs. 64-bit lock-free
+    bench_sys_timer();
+
+    // Release interval of a 10 ms loop with a 3 ms body: relative delay vs. periodic job
+    bench_periodic(false);
+    bench_periodic(true);
+
+    // Wake-ups and time asleep while the demo idles, against a fixed tick
+    bench_tickless_idle();
+
+    // Interrupt to waiting thread under load: event group via timer daemon vs. direct wake-up
+    bench_event_flags_latency(false);
+    bench_event_flags_latency(true);
+
+    // Producer outpacing a slow consumer: poll-and-retry allocation vs. sleeping until a block is freed
+    bench_mail_alloc_wait(false);
+    bench_mail_alloc_wait(true);
+
+    // The same operations through the CMSIS-RTOS v1 layer and through RTOS2 directly
+    bench_api(true);
+    bench_api(false);
+
+    osThreadExit();
+}
+
+
+/**
+ * @brief Time `server_log()` calls as seen by the caller. Calls are made in
+ *        bursts no larger than the logger queue, with a pause between bursts
+ *        to let the logger thread drain it, so no messages are dropped.
+ *
+ * @param is_async Send via the logger thread (`true`) or in place (`false`).
+ * @param stats    Results.
+ */
+static void bench_log_caller_latency(bool is_async, bench_stats_t* stats) {
+
+    bench_stats_reset(stats);
+    log_set_async(is_async);
+
+    for (uint32_t i = 0 ; i < BENCH_LOG_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        server_log("Bench %u", i);
+        bench_stats_add(stats, cycle_counter_read() - start);
+
+        if ((i % LOG_QUEUE_DEPTH) == LOG_QUEUE_DEPTH - 1) {
+            osDelay(BENCH_LOG_DRAIN_MS);
+        }
+    }
+
+    log_set_async(true);
+    osDelay(BENCH_LOG_DRAIN_MS);
+}
+
+
+/**
+ * @brief Log bursts of messages as fast as possible and report how many
+ *        `mvServerLog()` calls the logger thread needed to send them.
+ *
+ * @param is_batching Let the logger thread batch messages (`true`) or not.
+ */
+static void bench_log_batching(bool is_batching) {
+
+    log_stats_t before, after;
+
+    log_set_batching(is_batching);
+    log_get_stats(&before);
+
+    for (uint32_t burst = 0 ; burst < BENCH_LOG_BURSTS ; ++burst) {
+        for (uint32_t i = 0 ; i < LOG_QUEUE_DEPTH ; ++i) {
+            server_log("Burst %u message %u", burst, i);
+        }
+
+        osDelay(BENCH_LOG_DRAIN_MS);
+    }
+
+    log_get_stats(&after);
+    log_set_batching(true);
+
+    uint32_t syscalls = after.syscalls - before.syscalls;
+    uint32_t messages = after.messages - before.messages;
+    uint32_t bytes = after.bytes - before.bytes;
+    server_log("[BENCH] batching %s: %lu messages in %lu syscalls, %lu bytes/call",
+               is_batching ? "on" : "off",
+               (unsigned long)messages,
+               (unsigned long)syscalls,
+               (unsigned long)(syscalls > 0 ? bytes / syscalls : 0));
+}
+
+
+/**
+ * @brief Time `server_log()` calls that flood control drops. The first
+ *        calls from each site are sent, so only calls made once a site is
+ *        suppressing are measured.
+ *
+ * @param repeat_stats  Results for calls dropped as repeats.
+ * @param limited_stats Results for calls dropped by the rate limit.
+ */
+static void bench_log_suppressed(bench_stats_t* repeat_stats, bench_stats_t* limited_stats) {
+
+    bench_stats_reset(repeat_stats);
+    bench_stats_reset(limited_stats);
+
+    // Identical messages: after the first, each is a repeat until the
+    // site's rate limit cuts in
+    for (uint32_t i = 0 ; i < LOG_RATE_LIMIT_BURST ; ++i) {
+        uint32_t start = cycle_counter_read();
+        server_log("Bench repeat %u", 42);
+        if (i > 0) bench_stats_add(repeat_stats, cycle_counter_read() - start);
+    }
+
+    // Distinct messages: the first LOG_RATE_LIMIT_BURST go out, the rest
+    // are over the limit. Send in place so the queue cannot overflow
+    log_set_async(false);
+    for (uint32_t i = 0 ; i < BENCH_LOG_SUPPRESSED_CALLS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        server_log("Bench limit %u", i);
+        if (i >= LOG_RATE_LIMIT_BURST) bench_stats_add(limited_stats, cycle_counter_read() - start);
+    }
+
+    log_set_async(true);
+    osDelay(BENCH_LOG_DRAIN_MS);
+}
+
+
+/**
+ * @brief Time a call at each log level. Levels below LOG_LEVEL are removed
+ *        from the build, so their cost is that of reading the cycle counter.
+ */
+static void bench_log_levels(void) {
+
+    bench_stats_t stats[LOG_LEVEL_NONE];
+    static const char* const names[LOG_LEVEL_NONE] = {
+        "log_trace", "log_debug", "log_info", "log_warn", "log_error"
+    };
+
+    for (uint32_t level = 0 ; level < LOG_LEVEL_NONE ; ++level) {
+        bench_stats_reset(&stats[level]);
+    }
+
+    for (uint32_t i = 0 ; i < LOG_QUEUE_DEPTH ; ++i) {
+        uint32_t start = cycle_counter_read();
+        log_trace("Bench level %lu", (unsigned long)i);
+        bench_stats_add(&stats[LOG_LEVEL_TRACE], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        log_debug("Bench level %lu", (unsigned long)i);
+        bench_stats_add(&stats[LOG_LEVEL_DEBUG], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        log_info("Bench level %lu", (unsigned long)i);
+        bench_stats_add(&stats[LOG_LEVEL_INFO], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        log_warn("Bench level %lu", (unsigned long)i);
+        bench_stats_add(&stats[LOG_LEVEL_WARN], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        log_error("Bench level %lu", (unsigned long)i);
+        bench_stats_add(&stats[LOG_LEVEL_ERROR], cycle_counter_read() - start);
+
+        // Five messages per pass: let the logger thread keep up
+        osDelay(BENCH_LOG_DRAIN_MS);
+    }
+
+    server_log("[BENCH] log level threshold: %u", (unsigned)LOG_LEVEL);
+    for (uint32_t level = 0 ; level < LOG_LEVEL_NONE ; ++level) {
+        bench_stats_report(names[level], &stats[level]);
+    }
+}
+
+
+/**
+ * @brief Time delivery of a high-priority message through a message queue
+ *        holding a backlog of low-priority messages. Each sample is a put
+ *        followed by the get that returns it, so with priority ordering the
+ *        time should not depend on the size of the backlog.
+ */
+static void bench_mq_priority(void) {
+
+    osMessageQueueId_t queue = osMessageQueueNew(BENCH_MQ_DEPTH, sizeof(uint32_t), &bench_mq_attributes);
+    if (queue == NULL) {
+        server_error("[BENCH] could not create message queue");
+        return;
+    }
+
+    for (uint32_t backlog = 0 ; backlog < BENCH_MQ_DEPTH ; backlog += BENCH_MQ_BACKLOG_STEP) {
+        bench_stats_t stats;
+        bench_stats_reset(&stats);
+
+        for (uint32_t i = 0 ; i < backlog ; ++i) {
+            osMessageQueuePut(queue, &i, BENCH_MQ_PRIO_LOW, 0);
+        }
+
+        bool is_ordered = true;
+        for (uint32_t i = 0 ; i < BENCH_MQ_ITERATIONS ; ++i) {
+            uint32_t msg = UINT32_MAX, received = 0;
+            uint8_t prio = BENCH_MQ_PRIO_LOW;
+
+            uint32_t start = cycle_counter_read();
+            osMessageQueuePut(queue, &msg, BENCH_MQ_PRIO_HIGH, 0);
+            osMessageQueueGet(queue, &received, &prio, 0);
+            bench_stats_add(&stats, cycle_counter_read() - start);
+
+            if (received != msg || prio != BENCH_MQ_PRIO_HIGH) is_ordered = false;
+        }
+
+        osMessageQueueReset(queue);
+
+        server_log("[BENCH] message queue backlog %lu%s:", (unsigned long)backlog,
+                   is_ordered ? "" : " (OUT OF ORDER)");
+        bench_stats_report("high priority put+get", &stats);
+    }
+
+    osMessageQueueDelete(queue);
+}
+
+
+/**
+ * @brief Compare moving messages of a given size through a message queue,
+ *        which copies them in and out, with a mail queue, which passes a
+ *        pointer to a pool block that the sender fills in place. Each sample
+ *        writes one frame, sends it, receives it and reads it back.
+ *
+ * @param size The message size in bytes, up to BENCH_MAIL_MAX_SIZE_B.
+ */
+static void bench_mail_throughput(uint32_t size) {
+
+    const osMessageQueueAttr_t copy_attributes = {
+        .name = "Bench Copy",
+        .cb_mem = &bench_copy_cb,
+        .cb_size = sizeof(bench_copy_cb),
+        .mq_mem = bench_copy_mem,
+        .mq_size = sizeof(bench_copy_mem)
+    };
+    const osMailQueueAttr_t mail_attributes = {
+        .name = "Bench Mail",
+        .cb_mem = &bench_mail_cb,
+        .cb_size = sizeof(bench_mail_cb),
+        .mp_mem = bench_mail_mp_mem,
+        .mp_size = sizeof(bench_mail_mp_mem),
+        .mq_mem = bench_mail_mq_mem,
+        .mq_size = sizeof(bench_mail_mq_mem)
+    };
+
+    osMessageQueueId_t copy_queue = osMessageQueueNew(BENCH_MAIL_DEPTH, size, &copy_attributes);
+    osMailQueueId_t mail_queue = osMailQueueNew(BENCH_MAIL_DEPTH, size, &mail_attributes);
+    if (copy_queue == NULL || mail_queue == NULL) {
+        server_error("[BENCH] could not create %lu B queues", (unsigned long)size);
+        return;
+    }
+
+    bench_stats_t copy_stats, mail_stats;
+    bench_stats_reset(&copy_stats);
+    bench_stats_reset(&mail_stats);
+    uint32_t check = 0;
+
+    for (uint32_t i = 0 ; i < BENCH_MAIL_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        memset(bench_frame_in, (int)i, size);
+        osMessageQueuePut(copy_queue, bench_frame_in, 0, 0);
+        osMessageQueueGet(copy_queue, bench_frame_out, NULL, 0);
+        check += bench_frame_out[0];
+        bench_stats_add(&copy_stats, cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        uint32_t* frame = osMailQueueAlloc(mail_queue, 0);
+        if (frame == NULL) break;
+        memset(frame, (int)i, size);
+        osMailQueuePut(mail_queue, frame, 0);
+        osMailQueueGet(mail_queue, (void**)&frame, NULL, 0);
+        check -= frame[0];
+        osMailQueueFree(mail_queue, frame);
+        bench_stats_add(&mail_stats, cycle_counter_read() - start);
+    }
+
+    osMessageQueueDelete(copy_queue);
+    osMailQueueDelete(mail_queue);
+
+    server_log("[BENCH] %lu B messages: copy %lu KB/s, zero-copy %lu KB/s%s",
+               (unsigned long)size,
+               (unsigned long)bench_kb_per_s(size, &copy_stats),
+               (unsigned long)bench_kb_per_s(size, &mail_stats),
+               check == 0 ? "" : " (DATA MISMATCH)");
+    bench_stats_report("message queue put+get (copy)", &copy_stats);
+    bench_stats_report("mail queue alloc+put+get+free", &mail_stats);
+}
+
+
+/**
+ * @brief Convert a set of per-message timings to a throughput.
+ *
+ * @param size  The message size in bytes.
+ * @param stats The per-message timings.
+ *
+ * @retval Average throughput in KB/s, or 0 with no samples.
+ */
+static uint32_t bench_kb_per_s(uint32_t size, const bench_stats_t* stats) {
+
+    if (stats->count == 0 || stats->total == 0) return 0;
+    uint64_t bytes = (uint64_t)size * stats->count;
+    return (uint32_t)((bytes * SystemCoreClock) / stats->total / 1024);
+}
+
+
+/**
+ * @brief Compare a non-blocking `osMemoryPoolAlloc()`/`osMemoryPoolFree()`
+ *        pair, which uses the lock-free free list, with the same operations
+ *        done the previous way: take a semaphore, then pop the free list in
+ *        a critical section. Each is timed from a thread and from an
+ *        interrupt.
+ */
+static void bench_pool(void) {
+
+    const osMemoryPoolAttr_t pool_attributes = {
+        .name = "Bench Pool",
+        .cb_mem = &bench_pool_cb,
+        .cb_size = sizeof(bench_pool_cb),
+        .mp_mem = bench_pool_mem,
+        .mp_size = sizeof(bench_pool_mem)
+    };
+
+    bench_pool_id = osMemoryPoolNew(BENCH_POOL_BLOCKS, BENCH_POOL_BLOCK_SIZE_B, &pool_attributes);
+    bench_locked_pool.sem = xSemaphoreCreateCountingStatic(BENCH_POOL_BLOCKS, 0, &bench_locked_pool.sem_cb);
+    if (bench_pool_id == NULL || bench_locked_pool.sem == NULL) {
+        server_error("[BENCH] could not create memory pools");
+        return;
+    }
+
+    bench_locked_pool.head = NULL;
+    for (uint32_t i = 0 ; i < BENCH_POOL_BLOCKS ; ++i) {
+        bench_locked_free(&bench_locked_pool, (uint8_t*)bench_locked_mem + i * MEMPOOL_BLOCK_STRIDE(BENCH_POOL_BLOCK_SIZE_B));
+    }
+
+    bench_pool_job();
+    bench_stats_report("pool alloc+free, thread (lock-free)", &bench_pool_stats[0]);
+    bench_stats_report("pool alloc+free, thread (semaphore)", &bench_pool_stats[1]);
+
+    // FreeRTOS ...FromISR() calls are only allowed below the syscall priority ceiling
+    if (NVIC_GetPriority(TIM6_IRQn) >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) {
+        bench_run_in_isr(bench_pool_job);
+        bench_stats_report("pool alloc+free, ISR (lock-free)", &bench_pool_stats[0]);
+        bench_stats_report("pool alloc+free, ISR (semaphore)", &bench_pool_stats[1]);
+    } else {
+        server_log("[BENCH] pool alloc+free, ISR: skipped, tick interrupt priority too high");
+    }
+
+    osMemoryPoolDelete(bench_pool_id);
+    vSemaphoreDelete(bench_locked_pool.sem);
+}
+
+
+/**
+ * @brief Time alloc+free pairs on both pools. Runs in thread or interrupt
+ *        context, and leaves its results in `bench_pool_stats`.
+ */
+static void bench_pool_job(void) {
+
+    bench_stats_reset(&bench_pool_stats[0]);
+    bench_stats_reset(&bench_pool_stats[1]);
+
+    for (uint32_t i = 0 ; i < BENCH_POOL_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        void* block = osMemoryPoolAlloc(bench_pool_id, 0);
+        osMemoryPoolFree(bench_pool_id, block);
+        bench_stats_add(&bench_pool_stats[0], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        block = bench_locked_alloc(&bench_locked_pool);
+        bench_locked_free(&bench_locked_pool, block);
+        bench_stats_add(&bench_pool_stats[1], cycle_counter_read() - start);
+    }
+}
+
+
+/**
+ * @brief Take a block from a semaphore-guarded pool without blocking.
+ *
+ * @param pool The pool.
+ *
+ * @retval The block, or `NULL` if the pool is empty.
+ */
+static void* bench_locked_alloc(bench_locked_pool_t* pool) {
+
+    void* block = NULL;
+    if (__get_IPSR() != 0) {
+        if (xSemaphoreTakeFromISR(pool->sem, NULL) == pdTRUE) {
+            UBaseType_t isrm = taskENTER_CRITICAL_FROM_ISR();
+            block = pool->head;
+            pool->head = *(void**)block;
+            taskEXIT_CRITICAL_FROM_ISR(isrm);
+        }
+    } else if (xSemaphoreTake(pool->sem, 0) == pdTRUE) {
+        taskENTER_CRITICAL();
+        block = pool->head;
+        pool->head = *(void**)block;
+        taskEXIT_CRITICAL();
+    }
+
+    return block;
+}
+
+
+/**
+ * @brief Return a block to a semaphore-guarded pool.
+ *
+ * @param pool  The pool.
+ * @param block The block.
+ */
+static void bench_locked_free(bench_locked_pool_t* pool, void* block) {
+
+    if (__get_IPSR() != 0) {
+        UBaseType_t isrm = taskENTER_CRITICAL_FROM_ISR();
+        *(void**)block = pool->head;
+        pool->head = block;
+        taskEXIT_CRITICAL_FROM_ISR(isrm);
+
+        BaseType_t yield = pdFALSE;
+        xSemaphoreGiveFromISR(pool->sem, &yield);
+        portYIELD_FROM_ISR(yield);
+    } else {
+        taskENTER_CRITICAL();
+        *(void**)block = pool->head;
+        pool->head = block;
+        taskEXIT_CRITICAL();
+
+        xSemaphoreGive(pool->sem);
+    }
+}
+
+
+/**
+ * @brief Compare creating and deleting RTOS objects with heap allocated
+ *        control blocks, made with the FreeRTOS dynamic allocation calls the
+ *        CMSIS-RTOS2 layer used to make, with the slab allocated control
+ *        blocks that `os...New()` now uses. Times create+delete pairs, then
+ *        measures the heap fragmentation each way leaves behind.
+ */
+static void bench_control_blocks(void) {
+
+    char name[48];
+
+    for (uint32_t kind = 0 ; kind < BENCH_CB_KINDS ; ++kind) {
+        bench_stats_t stats[2];
+
+        for (uint32_t use_slab = 0 ; use_slab < 2 ; ++use_slab) {
+            bench_stats_reset(&stats[use_slab]);
+
+            for (uint32_t i = 0 ; i < BENCH_CB_ITERATIONS ; ++i) {
+                uint32_t start = cycle_counter_read();
+                void* handle = bench_cb_create((bench_cb_kind_t)kind, use_slab);
+                if (handle == NULL) break;
+                bench_cb_delete((bench_cb_kind_t)kind, use_slab, handle);
+                bench_stats_add(&stats[use_slab], cycle_counter_read() - start);
+
+                // Deleted timers are released by the timer service task
+                if (kind == BENCH_CB_TIMER) osDelay(1);
+            }
+        }
+
+        snprintf(name, sizeof(name), "%s create+delete (heap)", bench_cb_names[kind]);
+        bench_stats_report(name, &stats[0]);
+        snprintf(name, sizeof(name), "%s create+delete (slab)", bench_cb_names[kind]);
+        bench_stats_report(name, &stats[1]);
+    }
+
+    bench_cb_churn(false);
+    bench_cb_churn(true);
+}
+
+
+/**
+ * @brief Interleave short-lived RTOS objects with long-lived heap blocks, as
+ *        an application does when it creates a queue or timer per request,
+ *        and log the state of the heap afterwards. Each round creates one of
+ *        every object except a thread -- thread stacks stay on the heap
+ *        either way -- allocates a block that outlives them, then deletes them.
+ *
+ * @param use_slab `true` to create the objects through the CMSIS-RTOS2 layer,
+ *                 `false` to give them heap allocated control blocks.
+ */
+static void bench_cb_churn(bool use_slab) {
+
+    void* keep[BENCH_CB_CHURN_ROUNDS] = {NULL};
+    void* handles[BENCH_CB_THREAD];
+    HeapStats_t heap;
+
+    for (uint32_t round = 0 ; round < BENCH_CB_CHURN_ROUNDS ; ++round) {
+        for (uint32_t kind = 0 ; kind < BENCH_CB_THREAD ; ++kind) {
+            handles[kind] = bench_cb_create((bench_cb_kind_t)kind, use_slab);
+        }
+
+        keep[round] = pvPortMalloc(BENCH_CB_KEEP_SIZE_B + round * 8);
+
+        for (uint32_t kind = 0 ; kind < BENCH_CB_THREAD ; ++kind) {
+            if (handles[kind] != NULL) {
+                bench_cb_delete((bench_cb_kind_t)kind, use_slab, handles[kind]);
+            }
+        }
+
+        osDelay(1);
+    }
+
+    vPortGetHeapStats(&heap);
+    server_log("[BENCH] control block churn (%s): %lu free blocks, largest %lu B, %lu B free",
+               use_slab ? "slab" : "heap",
+               (unsigned long)heap.xNumberOfFreeBlocks,
+               (unsigned long)heap.xSizeOfLargestFreeBlockInBytes,
+               (unsigned long)heap.xAvailableHeapSpaceInBytes);
+
+    for (uint32_t round = 0 ; round < BENCH_CB_CHURN_ROUNDS ; ++round) {
+        vPortFree(keep[round]);
+    }
+}
+
+
+/**
+ * @brief Create an RTOS object of a given kind.
+ *
+ * @param kind     The kind of object.
+ * @param use_slab `true` to create it through the CMSIS-RTOS2 layer, `false`
+ *                 to create it with a heap allocated control block.
+ *
+ * @retval The object's handle, or `NULL` on failure.
+ */
+static void* bench_cb_create(bench_cb_kind_t kind, bool use_slab) {
+
+    const osThreadAttr_t thread_attributes = {
+        .name = "Bench Idle",
+        .stack_size = BENCH_CB_STACK_SIZE_B,
+        .priority = (osPriority_t)osPriorityLow
+    };
+
+    if (use_slab) {
+        switch (kind) {
+            case BENCH_CB_MUTEX:        return osMutexNew(NULL);
+            case BENCH_CB_SEMAPHORE:    return osSemaphoreNew(4, 0, NULL);
+            case BENCH_CB_EVENT_FLAGS:  return osEventFlagsNew(NULL);
+            case BENCH_CB_TIMER:        return osTimerNew(bench_cb_timer, osTimerOnce, NULL, NULL);
+            case BENCH_CB_THREAD:       return osThreadNew(bench_cb_idle, NULL, &thread_attributes);
+            default:                    return NULL;
+        }
+    }
+
+    TaskHandle_t task = NULL;
+    switch (kind) {
+        case BENCH_CB_MUTEX:        return xSemaphoreCreateMutex();
+        case BENCH_CB_SEMAPHORE:    return xSemaphoreCreateCounting(4, 0);
+        case BENCH_CB_EVENT_FLAGS:  return xEventGroupCreate();
+        case BENCH_CB_TIMER:
+            // The layer also kept each timer's callback and argument on the heap
+            return xTimerCreate("Bench", 1, pdFALSE, pvPortMalloc(2 * sizeof(void*)), bench_cb_heap_timer);
+        case BENCH_CB_THREAD:
+            xTaskCreate(bench_cb_idle, "Bench Idle", BENCH_CB_STACK_SIZE_B / sizeof(StackType_t), NULL,
+                        (UBaseType_t)osPriorityLow, &task);
+            return task;
+        default:
+            return NULL;
+    }
+}
+
+
+/**
+ * @brief Delete an RTOS object made by `bench_cb_create()`.
+ *
+ * @param kind     The kind of object.
+ * @param use_slab The value passed to `bench_cb_create()`.
+ * @param handle   The object's handle.
+ */
+static void bench_cb_delete(bench_cb_kind_t kind, bool use_slab, void* handle) {
+
+    if (use_slab) {
+        switch (kind) {
+            case BENCH_CB_MUTEX:        osMutexDelete(handle);          break;
+            case BENCH_CB_SEMAPHORE:    osSemaphoreDelete(handle);      break;
+            case BENCH_CB_EVENT_FLAGS:  osEventFlagsDelete(handle);     break;
+            case BENCH_CB_TIMER:        osTimerDelete(handle);          break;
+            case BENCH_CB_THREAD:       osThreadTerminate(handle);      break;
+            default:                                                    break;
+        }
+        return;
+    }
+
+    switch (kind) {
+        case BENCH_CB_MUTEX:
+        case BENCH_CB_SEMAPHORE:
+            vSemaphoreDelete(handle);
+            break;
+        case BENCH_CB_EVENT_FLAGS:
+            vEventGroupDelete(handle);
+            break;
+        case BENCH_CB_TIMER:
+            vPortFree(pvTimerGetTimerID(handle));
+            xTimerDelete(handle, 0);
+            break;
+        case BENCH_CB_THREAD:
+            vTaskDelete(handle);
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief Body of the benchmark's threads. They run below the benchmark
+ *        task, which deletes them before they are scheduled.
+ *
+ * @param argument: Not used.
+ */
+static void bench_cb_idle(void* argument) {
+
+    (void)argument;
+    while (true) {
+        osDelay(1000);
+    }
+}
+
+
+/**
+ * @brief Callbacks for the benchmark's timers, which are never started.
+ */
+static void bench_cb_timer(void* argument) {
+
+    (void)argument;
+}
+
+
+static void bench_cb_heap_timer(TimerHandle_t timer) {
+
+    (void)timer;
+}
+
+
+/**
+ * @brief Compare listing every thread the way `osThreadEnumerate()` used to,
+ *        suspending the scheduler around a heap allocated snapshot of all
+ *        task states, with walking the thread registry a few threads at a
+ *        time through `osThreadEnumerateNext()`. The registry walk is timed
+ *        per chunk, which bounds how long other tasks can be held off.
+ */
+static void bench_thread_enumerate(void) {
+
+    osThreadId_t threads[BENCH_ENUM_CHUNK];
+    bench_stats_t snapshot_stats, chunk_stats;
+    bench_stats_reset(&snapshot_stats);
+    bench_stats_reset(&chunk_stats);
+    uint32_t listed = 0;
+
+    for (uint32_t i = 0 ; i < BENCH_ENUM_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        vTaskSuspendAll();
+        UBaseType_t count = uxTaskGetNumberOfTasks();
+        TaskStatus_t* tasks = pvPortMalloc(count * sizeof(TaskStatus_t));
+        if (tasks != NULL) {
+            count = uxTaskGetSystemState(tasks, count, NULL);
+        }
+        xTaskResumeAll();
+        vPortFree(tasks);
+        bench_stats_add(&snapshot_stats, cycle_counter_read() - start);
+
+        uint32_t cursor = 0;
+        listed = 0;
+        while (true) {
+            start = cycle_counter_read();
+            uint32_t n = osThreadEnumerateNext(&cursor, threads, BENCH_ENUM_CHUNK);
+            bench_stats_add(&chunk_stats, cycle_counter_read() - start);
+            if (n == 0) break;
+            listed += n;
+        }
+    }
+
+    server_log("[BENCH] thread enumeration: %lu threads in registry, %lu tasks in kernel",
+               (unsigned long)listed, (unsigned long)uxTaskGetNumberOfTasks());
+    bench_stats_report("thread enumerate (suspended snapshot)", &snapshot_stats);
+    bench_stats_report("thread enumerate (registry chunk)", &chunk_stats);
+}
+
+
+/**
+ * @brief Count how often a thread waiting for all of eight flags is woken
+ *        when each flag is set separately, as when eight producers each
+ *        signal one event. The benchmark task stands in for the producers
+ *        and sets one flag per call. A higher priority consumer waits either
+ *        by looping on `xTaskNotifyWait()`, as `osThreadFlagsWait()` used to,
+ *        or with `osThreadFlagsWait()`, which now wakes it only once all its
+ *        flags are set. Every wake-up is a context switch to the consumer.
+ *
+ * @param is_notify_loop `true` to wait with the `xTaskNotifyWait()` loop,
+ *                       `false` to wait with `osThreadFlagsWait()`.
+ */
+static void bench_flags_wait_all(bool is_notify_loop) {
+
+    const osThreadAttr_t consumer_attributes = {
+        .name = "Bench Flags",
+        .stack_size = BENCH_FLAGS_STACK_SIZE_B,
+        .priority = (osPriority_t)osPriorityNormal
+    };
+
+    osThreadFlagsStats_t before, after;
+    bench_stats_reset(&bench_flags_stats);
+    bench_flags_wakeups = 0;
+
+    osThreadId_t consumer = osThreadNew(bench_flags_consumer, (void*)is_notify_loop, &consumer_attributes);
+    if (consumer == NULL) {
+        server_error("[BENCH] could not create flags consumer thread");
+        return;
+    }
+
+    osThreadFlagsGetStats(&before);
+    for (uint32_t round = 0 ; round < BENCH_FLAGS_ROUNDS ; ++round) {
+        bench_flags_start = cycle_counter_read();
+        for (uint32_t producer = 0 ; producer < BENCH_FLAGS_PRODUCERS ; ++producer) {
+            if (is_notify_loop) {
+                xTaskNotify((TaskHandle_t)consumer, 1UL << producer, eSetBits);
+            } else {
+                osThreadFlagsSet(consumer, 1UL << producer);
+            }
+        }
+    }
+    osThreadFlagsGetStats(&after);
+
+    // Let the consumer exit
+    osDelay(1);
+
+    server_log("[BENCH] wait for %u flags (%s): %lu wake-ups in %lu rounds, %lu spurious, %lu deferred",
+               BENCH_FLAGS_PRODUCERS,
+               is_notify_loop ? "notify loop" : "osThreadFlagsWait",
+               (unsigned long)bench_flags_wakeups,
+               (unsigned long)bench_flags_stats.count,
+               (unsigned long)(after.spurious - before.spurious),
+               (unsigned long)(after.deferred - before.deferred));
+    bench_stats_report(is_notify_loop ? "first flag set to all received (notify loop)"
+                                      : "first flag set to all received (osThreadFlagsWait)",
+                       &bench_flags_stats);
+}
+
+
+/**
+ * @brief Body of the flags benchmark's consumer thread. Waits for all the
+ *        producers' flags once per round, then exits.
+ *
+ * @param argument: Non-`NULL` to wait with the `xTaskNotifyWait()` loop.
+ */
+static void bench_flags_consumer(void* argument) {
+
+    const uint32_t all = (1UL << BENCH_FLAGS_PRODUCERS) - 1;
+
+    for (uint32_t round = 0 ; round < BENCH_FLAGS_ROUNDS ; ++round) {
+        if (argument != NULL) {
+            uint32_t flags = 0;
+            while ((flags & all) != all) {
+                uint32_t value = 0;
+                xTaskNotifyWait(0, all, &value, portMAX_DELAY);
+                flags |= value;
+                bench_flags_wakeups++;
+            }
+        } else {
+            osThreadFlagsWait(all, osFlagsWaitAll, osWaitForever);
+            bench_flags_wakeups++;
+        }
+
+        bench_stats_add(&bench_flags_stats, cycle_counter_read() - bench_flags_start);
+    }
+
+    osThreadExit();
+}
+
+
+/**
+ * @brief Compare reading the system timer the way `osKernelGetSysTimerCount()`
+ *        used to, from SysTick and the tick count with interrupts masked,
+ *        with reading the 64-bit timer, which masks nothing. Also times a
+ *        count to nanoseconds conversion, and checks that successive 64-bit
+ *        reads never go backwards. Each is run from a thread and from an
+ *        interrupt.
+ */
+static void bench_sys_timer(void) {
+
+    static const char* const names[2][3] = {
+        { "sys timer read, thread (32-bit, masked)", "sys timer read, thread (64-bit)", "sys timer to ns, thread" },
+        { "sys timer read, ISR (32-bit, masked)", "sys timer read, ISR (64-bit)", "sys timer to ns, ISR" }
+    };
+
+    for (uint32_t in_isr = 0 ; in_isr < 2 ; ++in_isr) {
+        if (in_isr) {
+            if (NVIC_GetPriority(TIM6_IRQn) < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) {
+                server_log("[BENCH] sys timer read, ISR: skipped, tick interrupt priority too high");
+                break;
+            }
+            bench_run_in_isr(bench_sys_timer_job);
+        } else {
+            bench_sys_timer_job();
+        }
+
+        for (uint32_t i = 0 ; i < 3 ; ++i) {
+            bench_stats_report(names[in_isr][i], &bench_timer_stats[i]);
+        }
+    }
+
+    uint64_t count = osKernelGetSysTimerCount64();
+    server_log("[BENCH] sys timer: %lu backward steps, uptime %lu ms",
+               (unsigned long)bench_timer_backwards,
+               (unsigned long)(osKernelSysTimerToNs(count) / 1000000));
+}
+
+
+/**
+ * @brief Time system timer reads and conversions. Runs in thread or
+ *        interrupt context, and leaves its results in `bench_timer_stats`.
+ */
+static void bench_sys_timer_job(void) {
+
+    for (uint32_t i = 0 ; i < 3 ; ++i) {
+        bench_stats_reset(&bench_timer_stats[i]);
+    }
+
+    uint64_t previous = osKernelGetSysTimerCount64();
+    for (uint32_t i = 0 ; i < BENCH_TIMER_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        volatile uint32_t low = bench_sys_timer_masked();
+        bench_stats_add(&bench_timer_stats[0], cycle_counter_read() - start);
+        (void)low;
+
+        start = cycle_counter_read();
+        uint64_t count = osKernelGetSysTimerCount64();
+        bench_stats_add(&bench_timer_stats[1], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        volatile uint64_t ns = osKernelSysTimerToNs(count);
+        bench_stats_add(&bench_timer_stats[2], cycle_counter_read() - start);
+        (void)ns;
+
+        if (count < previous) bench_timer_backwards++;
+        previous = count;
+    }
+}
+
+
+/**
+ * @brief Read the system timer as `osKernelGetSysTimerCount()` used to:
+ *        the tick count times the SysTick period plus the SysTick count,
+ *        with interrupts masked so the two are consistent.
+ *
+ * @retval The 32-bit system timer count.
+ */
+static uint32_t bench_sys_timer_masked(void) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    TickType_t ticks = (__get_IPSR() != 0) ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+    uint32_t count = SysTick->LOAD - SysTick->VAL;
+    if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0) {
+        count = SysTick->LOAD - SysTick->VAL;
+        ticks++;
+    }
+    count += ticks * (SysTick->LOAD + 1);
+
+    __set_PRIMASK(primask);
+    return count;
+}
+
+
+/**
+ * @brief Measure the time between releases of a loop whose body busy-waits
+ *        for a fixed time. With `osDelay()` the body's run time is added to
+ *        every period; a periodic job keeps to the nominal period.
+ *
+ * @param is_periodic_job `true` to pace the loop with `periodic_wait()`,
+ *                        `false` to use `osDelay()`.
+ */
+static void bench_periodic(bool is_periodic_job) {
+
+    bench_stats_t stats;
+    periodic_job_t job;
+    bench_stats_reset(&stats);
+    periodic_init(&job, BENCH_PERIODIC_PERIOD_MS);
+
+    uint32_t body_cycles = (SystemCoreClock / 1000000) * BENCH_PERIODIC_BODY_US;
+    uint32_t previous = cycle_counter_read();
+    for (uint32_t i = 0 ; i < BENCH_PERIODIC_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        while (cycle_counter_read() - start < body_cycles) {}
+
+        if (is_periodic_job) {
+            periodic_wait(&job);
+        } else {
+            osDelay(BENCH_PERIODIC_PERIOD_MS);
+        }
+
+        uint32_t now = cycle_counter_read();
+        bench_stats_add(&stats, now - previous);
+        previous = now;
+    }
+
+    bench_stats_report(is_periodic_job ? "10 ms loop release interval (periodic job)"
+                                       : "10 ms loop release interval (osDelay)", &stats);
+    if (is_periodic_job) {
+        periodic_report("Bench", &job);
+    }
+}
+
+
+/**
+ * @brief Measure how often the core wakes, and how much of the time it
+ *        sleeps, while this thread waits and only the demo threads run.
+ *        A fixed tick would wake the core `configTICK_RATE_HZ` times a
+ *        second for the kernel, and as often again for the HAL tick.
+ */
+static void bench_tickless_idle(void) {
+
+    osKernelIdleStats_t before, after;
+    osKernelGetIdleStats(&before);
+    uint64_t start = osKernelGetSysTimerCount64();
+
+    osDelay(BENCH_IDLE_WINDOW_MS);
+
+    osKernelGetIdleStats(&after);
+    uint64_t elapsed = osKernelGetSysTimerCount64() - start;
+    uint64_t elapsed_ms = osKernelSysTimerToNs(elapsed) / 1000000;
+    uint32_t wakeups = after.sleeps - before.sleeps;
+    uint32_t asleep_permille = (uint32_t)(((after.sleep_time - before.sleep_time) * 1000) / elapsed);
+
+    server_log("[BENCH] tickless idle: %lu wakeups/s (fixed tick: %lu), asleep %lu.%lu%%, %lu woken early, %lu aborted",
+               (unsigned long)((uint64_t)wakeups * 1000 / (elapsed_ms > 0 ? elapsed_ms : 1)),
+               (unsigned long)(2 * configTICK_RATE_HZ),
+               (unsigned long)(asleep_permille / 10), (unsigned long)(asleep_permille % 10),
+               (unsigned long)(after.early - before.early),
+               (unsigned long)(after.aborted - before.aborted));
+}
+
+
+/**
+ * @brief Measure the time from an interrupt setting an event flag to the
+ *        thread waiting for it running, while a normal priority thread
+ *        keeps the CPU busy. A FreeRTOS event group set from an ISR defers
+ *        the work to the low priority timer daemon, which must wait for the
+ *        load to yield; the layer's event flags wake the waiter directly.
+ *
+ * @param is_direct `true` to use `osEventFlagsSet()` and `osEventFlagsWait()`,
+ *                  `false` to use a FreeRTOS event group.
+ */
+static void bench_event_flags_latency(bool is_direct) {
+
+    const osThreadAttr_t waiter_attributes = {
+        .name = "Bench EF Wait",
+        .stack_size = BENCH_EF_STACK_SIZE_B,
+        .priority = (osPriority_t)osPriorityHigh
+    };
+
+    const osThreadAttr_t load_attributes = {
+        .name = "Bench EF Load",
+        .stack_size = BENCH_EF_STACK_SIZE_B,
+        .priority = (osPriority_t)osPriorityNormal
+    };
+
+    const char* name = is_direct ? "ISR to waiter, loaded (osEventFlagsSet)"
+                                 : "ISR to waiter, loaded (xEventGroupSetBitsFromISR)";
+
+    if (NVIC_GetPriority(TIM6_IRQn) < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) {
+        server_log("[BENCH] %s: skipped, tick interrupt priority too high", name);
+        return;
+    }
+
+    bench_stats_reset(&bench_ef_stats);
+    bench_ef_is_direct = is_direct;
+    bench_ef_is_loaded = true;
+    bench_ef_group = xEventGroupCreate();
+    bench_ef_id = osEventFlagsNew(NULL);
+
+    osThreadId_t waiter = NULL;
+    osThreadId_t load = NULL;
+    if (bench_ef_group != NULL && bench_ef_id != NULL) {
+        waiter = osThreadNew(bench_ef_waiter, NULL, &waiter_attributes);
+        load = osThreadNew(bench_ef_load, NULL, &load_attributes);
+    }
+
+    if (waiter != NULL && load != NULL) {
+        for (uint32_t round = 0 ; round < BENCH_EF_ROUNDS ; ++round) {
+            bench_run_in_isr(bench_ef_set_job);
+            while (bench_ef_stats.count <= round) {
+                osDelay(1);
+            }
+        }
+    } else {
+        server_error("[BENCH] could not set up %s", name);
+        if (waiter != NULL) osThreadTerminate(waiter);
+    }
+
+    // Let the load thread exit, and the idle task free both threads
+    bench_ef_is_loaded = false;
+    osDelay(BENCH_EF_LOAD_US / 1000 + 2);
+    if (bench_ef_group != NULL) vEventGroupDelete(bench_ef_group);
+    if (bench_ef_id != NULL) osEventFlagsDelete(bench_ef_id);
+
+    bench_stats_report(name, &bench_ef_stats);
+}
+
+
+/**
+ * @brief Body of the event flags benchmark's waiting thread. Waits for the
+ *        flag once per round, records how long it took to run, then exits.
+ *
+ * @param argument: Not used.
+ */
+static void bench_ef_waiter(void* argument) {
+
+    for (uint32_t round = 0 ; round < BENCH_EF_ROUNDS ; ++round) {
+        if (bench_ef_is_direct) {
+            osEventFlagsWait(bench_ef_id, BENCH_EF_FLAG, osFlagsWaitAny, osWaitForever);
+        } else {
+            xEventGroupWaitBits(bench_ef_group, BENCH_EF_FLAG, pdTRUE, pdFALSE, portMAX_DELAY);
+        }
+
+        bench_stats_add(&bench_ef_stats, cycle_counter_read() - bench_ef_start);
+    }
+
+    osThreadExit();
+}
+
+
+/**
+ * @brief Body of the event flags benchmark's load thread. Keeps the CPU
+ *        busy, pausing for a tick between bursts so lower priority threads
+ *        get to run, until told to stop.
+ *
+ * @param argument: Not used.
+ */
+static void bench_ef_load(void* argument) {
+
+    uint32_t burst_cycles = (SystemCoreClock / 1000000) * BENCH_EF_LOAD_US;
+    while (bench_ef_is_loaded) {
+        uint32_t start = cycle_counter_read();
+        while (cycle_counter_read() - start < burst_cycles) {}
+        osDelay(1);
+    }
+
+    osThreadExit();
+}
+
+
+/**
+ * @brief Set the event flag from interrupt context, noting the time.
+ */
+static void bench_ef_set_job(void) {
+
+    bench_ef_start = cycle_counter_read();
+    if (bench_ef_is_direct) {
+        osEventFlagsSet(bench_ef_id, BENCH_EF_FLAG);
+    } else {
+        BaseType_t yield = pdFALSE;
+        xEventGroupSetBitsFromISR(bench_ef_group, BENCH_EF_FLAG, &yield);
+        portYIELD_FROM_ISR(yield);
+    }
+}
+
+
+/**
+ * @brief Feed a mail queue from this thread faster than a higher priority
+ *        consumer drains it, so the producer spends most of its time
+ *        facing a full pool. A producer that polls and retries keeps the
+ *        CPU busy; one that waits in `osMailQueueAlloc()` sleeps until
+ *        the consumer frees a block, and the idle task can put the core to
+ *        sleep. Reports throughput, allocation attempts and time asleep.
+ *
+ * @param is_blocking `true` to wait in `osMailQueueAlloc()`, `false` to
+ *                    retry a non-blocking allocation after a yield.
+ */
+static void bench_mail_alloc_wait(bool is_blocking) {
+
+    const osThreadAttr_t consumer_attributes = {
+        .name = "Bench Mail Cons",
+        .stack_size = BENCH_MW_STACK_SIZE_B,
+        .priority = (osPriority_t)osPriorityNormal
+    };
+
+    const char* name = is_blocking ? "blocking alloc" : "poll and retry";
+
+    bench_mw_producer = osThreadGetId();
+    bench_mw_queue = osMailQueueNew(BENCH_MW_DEPTH, BENCH_MW_MAIL_SIZE_B, NULL);
+    osThreadId_t consumer = NULL;
+    if (bench_mw_queue != NULL) {
+        consumer = osThreadNew(bench_mw_consumer, NULL, &consumer_attributes);
+    }
+
+    if (consumer == NULL) {
+        server_error("[BENCH] could not set up mail producer (%s)", name);
+        if (bench_mw_queue != NULL) osMailQueueDelete(bench_mw_queue);
+        return;
+    }
+
+    osKernelIdleStats_t before, after;
+    osKernelGetIdleStats(&before);
+    uint64_t start = osKernelGetSysTimerCount64();
+    uint32_t attempts = 0;
+
+    for (uint32_t i = 0 ; i < BENCH_MW_MAILS ; ++i) {
+        uint32_t* mail = osMailQueueAlloc(bench_mw_queue, is_blocking ? osWaitForever : 0);
+        attempts++;
+        while (mail == NULL) {
+            osThreadYield();
+            mail = osMailQueueAlloc(bench_mw_queue, 0);
+            attempts++;
+        }
+
+        *mail = i;
+        osMailQueuePut(bench_mw_queue, mail, 0);
+    }
+
+    // The consumer signals once it has freed the last mail
+    osThreadFlagsWait(BENCH_MW_DONE_FLAG, osFlagsWaitAny, osWaitForever);
+
+    osKernelGetIdleStats(&after);
+    uint64_t elapsed = osKernelGetSysTimerCount64() - start;
+    uint64_t elapsed_ms = osKernelSysTimerToNs(elapsed) / 1000000;
+    uint32_t asleep_permille = (uint32_t)(((after.sleep_time - before.sleep_time) * 1000) / elapsed);
+
+    // Let the idle task free the consumer
+    osDelay(2);
+    osMailQueueDelete(bench_mw_queue);
+
+    server_log("[BENCH] mail producer (%s): %lu mails/s, %lu alloc attempts for %lu mails, asleep %lu.%lu%%",
+               name,
+               (unsigned long)((uint64_t)BENCH_MW_MAILS * 1000 / (elapsed_ms > 0 ? elapsed_ms : 1)),
+               (unsigned long)attempts, (unsigned long)BENCH_MW_MAILS,
+               (unsigned long)(asleep_permille / 10), (unsigned long)(asleep_permille % 10));
+}
+
+
+/**
+ * @brief Body of the mail allocation benchmark's consumer thread. Takes
+ *        each mail, holds it for a few ticks as if processing it, then
+ *        frees it. Tells the producer once all the mails are done.
+ *
+ * @param argument: Not used.
+ */
+static void bench_mw_consumer(void* argument) {
+
+    for (uint32_t i = 0 ; i < BENCH_MW_MAILS ; ++i) {
+        uint32_t* mail;
+        if (osMailQueueGet(bench_mw_queue, (void**)&mail, NULL, osWaitForever) != osOK) break;
+        osDelay(BENCH_MW_CONSUME_MS);
+        osMailQueueFree(bench_mw_queue, mail);
+    }
+
+    osThreadFlagsSet(bench_mw_producer, BENCH_MW_DONE_FLAG);
+    osThreadExit();
+}
+
+
+/**
+ * @brief Time the same operations through the CMSIS-RTOS v1 API, which is
+ *        a thin layer over the RTOS2 wrapper, or through RTOS2 directly.
+ *        The difference between the two is the cost of the v1 layer.
+ *
+ * @param is_v1 `true` to use the v1 API, `false` to use RTOS2.
+ */
+static void bench_api(bool is_v1) {
+
+    osMessageQueueId_t queue;
+    osMemoryPoolId_t pool;
+    osMailQueueId_t mail_queue;
+    osSemaphoreId_t semaphore;
+
+    if (is_v1) {
+        queue = osMessageCreate(osMessageQ(bench_v1_queue), NULL);
+        pool = osPoolCreate(osPool(bench_v1_pool));
+        mail_queue = osMailCreate(osMailQ(bench_v1_mail), NULL);
+        semaphore = osSemaphoreCreate(osSemaphore(bench_v1_semaphore), 1);
+    } else {
+        queue = osMessageQueueNew(BENCH_API_DEPTH, sizeof(uint32_t), NULL);
+        pool = osMemoryPoolNew(BENCH_API_DEPTH, sizeof(bench_api_item_t), NULL);
+        mail_queue = osMailQueueNew(BENCH_API_DEPTH, sizeof(bench_api_item_t), NULL);
+        semaphore = osSemaphoreNew(1, 1, NULL);
+    }
+
+    bool is_created = (queue != NULL && pool != NULL && mail_queue != NULL && semaphore != NULL);
+    bench_stats_t stats[BENCH_API_OPS];
+    for (uint32_t op = 0 ; op < BENCH_API_OPS ; ++op) {
+        bench_stats_reset(&stats[op]);
+    }
+
+    uint32_t mismatches = 0;
+    osThreadId_t self = osThreadGetId();
+
+    for (uint32_t i = 0 ; is_created && i < BENCH_API_ITERATIONS ; ++i) {
+        uint32_t start = cycle_counter_read();
+        uint32_t value = i;
+        if (is_v1) {
+            osMessagePut(queue, value, 0);
+            value = osMessageGet(queue, 0).value.v;
+        } else {
+            osMessageQueuePut(queue, &value, 0, 0);
+            osMessageQueueGet(queue, &value, NULL, 0);
+        }
+        bench_stats_add(&stats[BENCH_API_MESSAGE], cycle_counter_read() - start);
+        if (value != i) mismatches++;
+
+        start = cycle_counter_read();
+        if (is_v1) {
+            osPoolFree(pool, osPoolAlloc(pool));
+        } else {
+            osMemoryPoolFree(pool, osMemoryPoolAlloc(pool, 0));
+        }
+        bench_stats_add(&stats[BENCH_API_POOL], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        bench_api_item_t* mail;
+        if (is_v1) {
+            mail = osMailAlloc(mail_queue, 0);
+            mail->words[0] = i;
+            osMailPut(mail_queue, mail);
+            mail = osMailGet(mail_queue, 0).value.p;
+        } else {
+            mail = osMailQueueAlloc(mail_queue, 0);
+            mail->words[0] = i;
+            osMailQueuePut(mail_queue, mail, 0);
+            osMailQueueGet(mail_queue, (void**)&mail, NULL, 0);
+        }
+        if (mail->words[0] != i) mismatches++;
+        if (is_v1) {
+            osMailFree(mail_queue, mail);
+        } else {
+            osMailQueueFree(mail_queue, mail);
+        }
+        bench_stats_add(&stats[BENCH_API_MAIL], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        if (is_v1) {
+            osSemaphoreWait(semaphore, 0);
+        } else {
+            osSemaphoreAcquire(semaphore, 0);
+        }
+        osSemaphoreRelease(semaphore);
+        bench_stats_add(&stats[BENCH_API_SEMAPHORE], cycle_counter_read() - start);
+
+        start = cycle_counter_read();
+        if (is_v1) {
+            osSignalSet(self, BENCH_API_SIGNAL);
+            osSignalWait(BENCH_API_SIGNAL, 0);
+        } else {
+            osThreadFlagsSet(self, BENCH_API_SIGNAL);
+            osThreadFlagsWait(BENCH_API_SIGNAL, osFlagsWaitAny, 0);
+        }
+        bench_stats_add(&stats[BENCH_API_SIGNAL_OP], cycle_counter_read() - start);
+    }
+
+    // v1 objects are RTOS2 objects, so either API can delete them
+    if (queue != NULL) osMessageQueueDelete(queue);
+    if (pool != NULL) osMemoryPoolDelete(pool);
+    if (mail_queue != NULL) osMailQueueDelete(mail_queue);
+    if (semaphore != NULL) osSemaphoreDelete(semaphore);
+
+    if (!is_created) {
+        server_error("[BENCH] could not create %s objects", is_v1 ? "v1" : "v2");
+        return;
+    }
+
+    if (mismatches > 0) server_error("[BENCH] %s API: DATA MISMATCH", is_v1 ? "v1" : "v2");
+    for (uint32_t op = 0 ; op < BENCH_API_OPS ; ++op) {
+        bench_stats_report(is_v1 ? bench_api_v1_names[op] : bench_api_v2_names[op], &stats[op]);
+    }
+}
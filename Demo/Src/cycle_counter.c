@@ -0,0 +1,42 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdint.h>
+// Microvisor + HAL
+#include "stm32u5xx_hal.h"
+#include "cmsis_os.h"
+// Application
+#include "cycle_counter.h"
+
+
+/**
+ * @brief Read the DWT cycle counter extended to 64 bits. This is the
+ *        kernel's 64-bit system timer, which tracks counter wraps every
+ *        tick, so it does not mask interrupts. Safe to call from threads
+ *        and interrupt handlers.
+ *
+ * @retval The cycle count since the counter was started.
+ */
+uint64_t cycle_counter_read64(void) {
+
+    return osKernelGetSysTimerCount64();
+}
+
+
+/**
+ * @brief Convert a cycle count to microseconds at the current core clock.
+ *
+ * @param cycles The cycle count.
+ *
+ * @retval The equivalent time in microseconds.
+ */
+uint64_t cycle_counter_to_us(uint64_t cycles) {
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000U;
+    return cycles / (cycles_per_us > 0 ? cycles_per_us : 1);
+}
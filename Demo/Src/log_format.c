@@ -0,0 +1,455 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+// Application
+#include "log_format.h"
+
+
+/*
+ * PRIVATE DEFINITIONS
+ */
+#define     FORMAT_FLAG_LEFT            0x01U
+#define     FORMAT_FLAG_ZERO            0x02U
+#define     FORMAT_FLAG_PLUS            0x04U
+#define     FORMAT_FLAG_SPACE           0x08U
+#define     FORMAT_FLAG_ALT             0x10U
+#define     FORMAT_DIGITS_MAX           20
+
+
+/*
+ * PRIVATE TYPES
+ */
+typedef struct {
+    char*       buffer;
+    uint32_t    size;
+    uint32_t    length;         // Characters written to `buffer`
+    uint32_t    total;          // Characters in the whole message
+} format_out_t;
+
+// An integer conversion's length modifier
+typedef enum {
+    FORMAT_LENGTH_NONE,
+    FORMAT_LENGTH_HH,
+    FORMAT_LENGTH_H,
+    FORMAT_LENGTH_L,
+    FORMAT_LENGTH_LL,
+    FORMAT_LENGTH_J,
+    FORMAT_LENGTH_Z,
+    FORMAT_LENGTH_T
+} format_length_t;
+
+
+/*
+ * PRIVATE FUNCTION PROTOTYPES
+ */
+static void     put_char(format_out_t* out, char c);
+static void     put_text(format_out_t* out, const char* text, uint32_t length);
+static void     put_padding(format_out_t* out, char c, uint32_t count);
+static void     put_field(format_out_t* out, const char* prefix, const char* text, uint32_t length,
+                          uint32_t width, uint32_t flags);
+static uint32_t read_number(const char** format, va_list* args);
+static format_length_t read_length(const char** format);
+static int64_t  read_signed(va_list* args, format_length_t length);
+static uint64_t read_unsigned(va_list* args, format_length_t length);
+static uint32_t u32_to_digits(char* end, uint32_t value, uint32_t base, const char* symbols);
+static uint32_t u64_to_digits(char* end, uint64_t value, uint32_t base, const char* symbols);
+
+
+/*
+ * GLOBALS
+ */
+static const char lower_digits[] = "0123456789abcdef";
+static const char upper_digits[] = "0123456789ABCDEF";
+
+
+/**
+ * @brief Format a message into a buffer.
+ *
+ * @param buffer        The output buffer.
+ * @param size          The buffer size in bytes, including the NUL.
+ * @param format_string Message string with optional formatting.
+ * @param ...           Optional injectable values.
+ *
+ * @retval The length of the whole message, excluding the NUL, as for
+ *         snprintf(). If it is `size` or more, the output was truncated.
+ */
+uint32_t log_format(char* buffer, uint32_t size, const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    uint32_t length = log_vformat(buffer, size, format_string, args);
+    va_end(args);
+    return length;
+}
+
+
+/**
+ * @brief Format a message into a buffer. Uses a fixed, small amount of
+ *        stack and no heap or reentrancy state.
+ *
+ * @param buffer        The output buffer.
+ * @param size          The buffer size in bytes, including the NUL.
+ * @param format_string Message string with optional formatting.
+ * @param args          The values to inject.
+ *
+ * @retval The length of the whole message, excluding the NUL, as for
+ *         vsnprintf(). If it is `size` or more, the output was truncated.
+ */
+uint32_t log_vformat(char* buffer, uint32_t size, const char* format_string, va_list args) {
+
+    format_out_t out = { .buffer = buffer, .size = size, .length = 0, .total = 0 };
+    char digits[FORMAT_DIGITS_MAX];
+    char* digits_end = digits + sizeof(digits);
+
+    // Work on a copy so the list can be passed by pointer on every ABI
+    va_list ap;
+    va_copy(ap, args);
+
+    for (const char* p = format_string ; *p != '\0' ; ++p) {
+        if (*p != '%') {
+            // Copy literal text up to the next conversion in one go
+            const char* run = p;
+            while (p[1] != '\0' && p[1] != '%') ++p;
+            put_text(&out, run, (uint32_t)(p - run) + 1);
+            continue;
+        }
+
+        const char* spec = p++;
+        uint32_t flags = 0;
+        for ( ; *p == '-' || *p == '0' || *p == '+' || *p == ' ' || *p == '#' ; ++p) {
+            if (*p == '-') flags |= FORMAT_FLAG_LEFT;
+            if (*p == '0') flags |= FORMAT_FLAG_ZERO;
+            if (*p == '+') flags |= FORMAT_FLAG_PLUS;
+            if (*p == ' ') flags |= FORMAT_FLAG_SPACE;
+            if (*p == '#') flags |= FORMAT_FLAG_ALT;
+        }
+
+        uint32_t width = read_number(&p, &ap);
+        uint32_t precision = UINT32_MAX;
+        if (*p == '.') {
+            ++p;
+            precision = read_number(&p, &ap);
+        }
+
+        format_length_t length = read_length(&p);
+
+        const char* prefix = "";
+        uint32_t count = 0;
+        switch (*p) {
+            case 'd':
+            case 'i': {
+                int64_t value = read_signed(&ap, length);
+                uint64_t magnitude = (value < 0) ? 0 - (uint64_t)value : (uint64_t)value;
+                if (value < 0) {
+                    prefix = "-";
+                } else if (flags & FORMAT_FLAG_PLUS) {
+                    prefix = "+";
+                } else if (flags & FORMAT_FLAG_SPACE) {
+                    prefix = " ";
+                }
+                count = (magnitude > UINT32_MAX) ? u64_to_digits(digits_end, magnitude, 10, lower_digits)
+                                                 : u32_to_digits(digits_end, (uint32_t)magnitude, 10, lower_digits);
+                put_field(&out, prefix, digits_end - count, count, width, flags);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint32_t base = (*p == 'u') ? 10 : 16;
+                const char* symbols = (*p == 'X') ? upper_digits : lower_digits;
+                uint64_t value = read_unsigned(&ap, length);
+                if (base == 16 && value != 0 && (flags & FORMAT_FLAG_ALT)) {
+                    prefix = (*p == 'X') ? "0X" : "0x";
+                }
+                count = (value > UINT32_MAX) ? u64_to_digits(digits_end, value, base, symbols)
+                                             : u32_to_digits(digits_end, (uint32_t)value, base, symbols);
+                put_field(&out, prefix, digits_end - count, count, width, flags);
+                break;
+            }
+            case 'p':
+                count = u32_to_digits(digits_end, (uint32_t)(uintptr_t)va_arg(ap, void*), 16, lower_digits);
+                put_field(&out, "0x", digits_end - count, count, width, flags);
+                break;
+            case 'c':
+                digits[0] = (char)va_arg(ap, int);
+                put_field(&out, prefix, digits, 1, width, flags);
+                break;
+            case 's': {
+                const char* text = va_arg(ap, const char*);
+                if (text == NULL) text = "(null)";
+                while (count < precision && text[count] != '\0') count++;
+                put_field(&out, prefix, text, count, width, flags);
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                // Not supported: skip the value
+                (void)va_arg(ap, double);
+                put_field(&out, prefix, "?", 1, width, flags);
+                break;
+            case '%':
+                put_char(&out, '%');
+                break;
+            default:
+                // Unknown or incomplete: show it as it was written
+                for ( ; spec <= p && *spec != '\0' ; ++spec) put_char(&out, *spec);
+                if (*p == '\0') --p;
+        }
+    }
+
+    va_end(ap);
+
+    if (size > 0) buffer[out.length] = '\0';
+    return out.total;
+}
+
+
+/**
+ * @brief Append a character, if there is room for it and the NUL. It is
+ *        counted in the message's length either way.
+ *
+ * @param out The output state.
+ * @param c   The character.
+ */
+static void put_char(format_out_t* out, char c) {
+
+    out->total++;
+
+    if (out->length + 1 < out->size) {
+        out->buffer[out->length++] = c;
+    }
+}
+
+
+/**
+ * @brief Append as much of a run of characters as there is room for. All
+ *        of them are counted in the message's length.
+ *
+ * @param out    The output state.
+ * @param text   The characters.
+ * @param length The number of characters.
+ */
+static void put_text(format_out_t* out, const char* text, uint32_t length) {
+
+    out->total += length;
+
+    if (out->length + 1 >= out->size) return;
+
+    uint32_t room = out->size - 1 - out->length;
+    if (length > room) length = room;
+    memcpy(&out->buffer[out->length], text, length);
+    out->length += length;
+}
+
+
+/**
+ * @brief Append a run of padding characters.
+ *
+ * @param out   The output state.
+ * @param c     The padding character.
+ * @param count The number of characters.
+ */
+static void put_padding(format_out_t* out, char c, uint32_t count) {
+
+    while (count-- > 0) put_char(out, c);
+}
+
+
+/**
+ * @brief Append a converted value, padded to the field width. Zero padding
+ *        goes between the prefix (sign or `0x`) and the digits.
+ *
+ * @param out    The output state.
+ * @param prefix The prefix, or an empty string.
+ * @param text   The value's characters.
+ * @param length The number of characters in `text`.
+ * @param width  The minimum field width.
+ * @param flags  FORMAT_FLAG_* bits.
+ */
+static void put_field(format_out_t* out, const char* prefix, const char* text, uint32_t length,
+                      uint32_t width, uint32_t flags) {
+
+    uint32_t prefix_length = 0;
+    while (prefix[prefix_length] != '\0') prefix_length++;
+
+    uint32_t used = prefix_length + length;
+    uint32_t padding = (width > used) ? width - used : 0;
+
+    if (!(flags & FORMAT_FLAG_LEFT) && !(flags & FORMAT_FLAG_ZERO)) put_padding(out, ' ', padding);
+    put_text(out, prefix, prefix_length);
+    if (!(flags & FORMAT_FLAG_LEFT) && (flags & FORMAT_FLAG_ZERO)) put_padding(out, '0', padding);
+    put_text(out, text, length);
+    if (flags & FORMAT_FLAG_LEFT) put_padding(out, ' ', padding);
+}
+
+
+/**
+ * @brief Read a width or precision: decimal digits, or '*' to take it from
+ *        the arguments. A negative '*' value is treated as zero.
+ *
+ * @param format The format string position, advanced past the number.
+ * @param args   The arguments.
+ *
+ * @retval The number, or 0 if there was none.
+ */
+static uint32_t read_number(const char** format, va_list* args) {
+
+    const char* p = *format;
+    uint32_t value = 0;
+
+    if (*p == '*') {
+        int arg = va_arg(*args, int);
+        value = (arg < 0) ? 0 : (uint32_t)arg;
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + (uint32_t)(*p++ - '0');
+        }
+    }
+
+    *format = p;
+    return value;
+}
+
+
+/**
+ * @brief Read an integer conversion's length modifier, if it has one.
+ *
+ * @param format The format string position, advanced past the modifier.
+ *
+ * @retval The length modifier, or `FORMAT_LENGTH_NONE`.
+ */
+static format_length_t read_length(const char** format) {
+
+    const char* p = *format;
+    format_length_t length = FORMAT_LENGTH_NONE;
+
+    switch (*p) {
+        case 'h':
+            length = (p[1] == 'h') ? FORMAT_LENGTH_HH : FORMAT_LENGTH_H;
+            break;
+        case 'l':
+            length = (p[1] == 'l') ? FORMAT_LENGTH_LL : FORMAT_LENGTH_L;
+            break;
+        case 'j':
+            length = FORMAT_LENGTH_J;
+            break;
+        case 'z':
+            length = FORMAT_LENGTH_Z;
+            break;
+        case 't':
+            length = FORMAT_LENGTH_T;
+            break;
+        default:
+            break;
+    }
+
+    if (length == FORMAT_LENGTH_HH || length == FORMAT_LENGTH_LL) ++p;
+    if (length != FORMAT_LENGTH_NONE) ++p;
+
+    *format = p;
+    return length;
+}
+
+
+/**
+ * @brief Take a signed integer argument of the given length. `h` and `hh`
+ *        values are passed as `int`, and are narrowed as printf() does.
+ *
+ * @param args   The arguments.
+ * @param length The conversion's length modifier.
+ *
+ * @retval The value.
+ */
+static int64_t read_signed(va_list* args, format_length_t length) {
+
+    switch (length) {
+        case FORMAT_LENGTH_HH:  return (signed char)va_arg(*args, int);
+        case FORMAT_LENGTH_H:   return (short)va_arg(*args, int);
+        case FORMAT_LENGTH_L:   return va_arg(*args, long);
+        case FORMAT_LENGTH_LL:  return va_arg(*args, long long);
+        case FORMAT_LENGTH_J:   return va_arg(*args, intmax_t);
+        case FORMAT_LENGTH_Z:
+        case FORMAT_LENGTH_T:   return va_arg(*args, ptrdiff_t);
+        default:                return va_arg(*args, int);
+    }
+}
+
+
+/**
+ * @brief Take an unsigned integer argument of the given length. `h` and
+ *        `hh` values are passed as `int`, and are narrowed as printf() does.
+ *
+ * @param args   The arguments.
+ * @param length The conversion's length modifier.
+ *
+ * @retval The value.
+ */
+static uint64_t read_unsigned(va_list* args, format_length_t length) {
+
+    switch (length) {
+        case FORMAT_LENGTH_HH:  return (unsigned char)va_arg(*args, unsigned int);
+        case FORMAT_LENGTH_H:   return (unsigned short)va_arg(*args, unsigned int);
+        case FORMAT_LENGTH_L:   return va_arg(*args, unsigned long);
+        case FORMAT_LENGTH_LL:  return va_arg(*args, unsigned long long);
+        case FORMAT_LENGTH_J:   return va_arg(*args, uintmax_t);
+        case FORMAT_LENGTH_Z:   return va_arg(*args, size_t);
+        case FORMAT_LENGTH_T:   return (size_t)va_arg(*args, ptrdiff_t);
+        default:                return va_arg(*args, unsigned int);
+    }
+}
+
+
+/**
+ * @brief Write a 32-bit value's digits backwards from `end`.
+ *
+ * @param end     One past the last digit's position.
+ * @param value   The value.
+ * @param base    10 or 16.
+ * @param symbols The digit characters.
+ *
+ * @retval The number of digits written.
+ */
+static uint32_t u32_to_digits(char* end, uint32_t value, uint32_t base, const char* symbols) {
+
+    uint32_t count = 0;
+    do {
+        *--end = symbols[value % base];
+        value /= base;
+        count++;
+    } while (value != 0);
+
+    return count;
+}
+
+
+/**
+ * @brief Write a 64-bit value's digits backwards from `end`. Kept apart
+ *        from u32_to_digits() so values that fit in 32 bits avoid 64-bit
+ *        division.
+ *
+ * @param end     One past the last digit's position.
+ * @param value   The value.
+ * @param base    10 or 16.
+ * @param symbols The digit characters.
+ *
+ * @retval The number of digits written.
+ */
+static uint32_t u64_to_digits(char* end, uint64_t value, uint32_t base, const char* symbols) {
+
+    uint32_t count = 0;
+    do {
+        *--end = symbols[value % base];
+        value /= base;
+        count++;
+    } while (value != 0);
+
+    return count;
+}
@@ -0,0 +1,1215 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+// Microvisor + HAL
+#include "cmsis_os.h"
+#include "mv_syscalls.h"
+#include "stm32u5xx_hal.h"
+// Application
+#include "logging.h"
+#include "log_format.h"
+#include "cycle_counter.h"
+
+
+/*
+ * PRIVATE DEFINITIONS
+ */
+#define     LOG_QUEUE_MASK              (LOG_QUEUE_DEPTH - 1)
+#define     LOG_FLAG_PENDING            0x01U
+
+#define     LOG_ISR_RING_MASK           (LOG_ISR_RING_DEPTH - 1)
+#define     LOG_ISR_THREAD_RING         LOG_ISR_PRIORITY_LEVELS
+#define     LOG_ISR_NMI_RING            (LOG_ISR_PRIORITY_LEVELS + 1)
+#define     LOG_ISR_FAULT_RING          (LOG_ISR_PRIORITY_LEVELS + 2)
+#define     LOG_ISR_RING_COUNT          (LOG_ISR_PRIORITY_LEVELS + 3)
+#define     LOG_ISR_LINE_MAX_B          128
+
+// Deferred record flags, held in the record's first byte
+#define     LOG_RECORD_FLAG_ERROR       0x01U
+#define     LOG_RECORD_FLAG_TRUNCATED   0x02U
+#define     LOG_RECORD_FLAG_TIMESTAMP   0x04U
+#define     LOG_RECORD_FLAG_ISR         0x08U
+#define     LOG_RECORD_FLAG_SUMMARY     0x10U
+
+#define     LOG_HASH_SEED               2166136261U
+#define     LOG_HASH_PRIME              16777619U
+
+// Deferred records are sent as '#' plus unpadded base64 so they survive the text log stream
+#define     LOG_RECORD_MARKER           '#'
+#define     LOG_RECORD_LINE_MAX_B       (1 + ((LOG_RECORD_MAX_LEN_B + 2) / 3) * 4)
+
+_Static_assert((LOG_QUEUE_DEPTH & LOG_QUEUE_MASK) == 0, "LOG_QUEUE_DEPTH must be a power of two");
+_Static_assert((LOG_ISR_RING_DEPTH & LOG_ISR_RING_MASK) == 0, "LOG_ISR_RING_DEPTH must be a power of two");
+_Static_assert((1U << __NVIC_PRIO_BITS) <= LOG_ISR_PRIORITY_LEVELS, "LOG_ISR_PRIORITY_LEVELS must cover every NVIC priority");
+
+
+/*
+ * PRIVATE TYPES
+ */
+// A queued message. `sequence` tells producers and the logger task who owns
+// the slot: it equals the enqueue position when the slot is free, and that
+// position plus one once the message has been committed
+typedef struct {
+    _Atomic uint32_t    sequence;
+    uint16_t            length;
+    bool                is_err;
+    uint8_t             data[LOG_SLOT_SIZE_B];
+} log_slot_t;
+
+// An unformatted record posted by server_log_from_isr()
+typedef struct {
+    uint64_t            timestamp;
+    const char*         format_string;
+    uint32_t            arg_count;
+    uint32_t            args[LOG_ISR_ARGS_MAX];
+} log_isr_record_t;
+
+// Single-producer ring: only code running at the ring's interrupt priority
+// writes `head`, and those handlers cannot preempt one another
+typedef struct {
+    _Atomic uint32_t    head;
+    _Atomic uint32_t    tail;
+    log_isr_record_t    records[LOG_ISR_RING_DEPTH];
+} log_isr_ring_t;
+
+// Where a message is being written: a reserved queue slot, or the sync
+// buffer when the message is to be sent in place
+typedef struct {
+    log_slot_t*         slot;
+    uint8_t*            data;
+} log_writer_t;
+
+
+/*
+ * PRIVATE FUNCTION PROTOTYPES
+ */
+static void         start_log_task(void *argument);
+static bool         site_take_token(log_site_t* site);
+static bool         site_is_repeat(log_site_t* site, uint32_t hash, bool is_err, const char* format_id);
+static void         post_summary(log_site_t* site, bool is_err, const char* format_id);
+static uint32_t     hash_bytes(uint32_t hash, const uint8_t* data, uint32_t length);
+#if !LOG_DEFERRED_FORMAT
+static void         post_log(bool is_err, const char* format_string, va_list args);
+static uint32_t     hash_text_args(const char* format_string, va_list args);
+static uint32_t     format_timestamp(char* buffer, uint32_t size, uint64_t timestamp);
+static bool         append_format(char* buffer, uint32_t size, uint32_t* length, const char* format_string, ...) __attribute__((format(printf, 4, 5)));
+static bool         append_vformat(char* buffer, uint32_t size, uint32_t* length, const char* format_string, va_list args);
+#else
+static void         record_start(log_record_t* record, uint8_t flags, const char* format_id, uint64_t timestamp);
+static void         put_bytes(log_record_t* record, const uint8_t* data, uint32_t length);
+static void         put_varint(log_record_t* record, uint64_t value);
+static uint16_t     encode_base64(const uint8_t* data, uint16_t length, char* line);
+#endif
+static void         submit_message(const uint8_t* data, uint16_t length, bool is_err);
+static uint8_t*     open_message(log_writer_t* writer);
+static void         close_message(log_writer_t* writer, uint16_t length, bool is_err);
+static void         send_message(const uint8_t* data, uint16_t length, bool is_err, bool may_batch);
+static void         write_log(const uint8_t* data, uint16_t length, uint32_t message_count);
+static void         batch_add(const uint8_t* data, uint16_t length, bool is_err);
+static void         batch_flush(void);
+static uint32_t     batch_timeout(void);
+static void         drain_isr_rings(void);
+static void         send_isr_record(uint32_t level, const log_isr_record_t* record);
+static log_slot_t*  reserve_slot(void);
+static void         commit_slot(log_slot_t* slot);
+static log_slot_t*  next_committed_slot(void);
+static void         release_slot(log_slot_t* slot);
+
+
+/*
+ * GLOBALS
+ */
+static log_slot_t       log_slots[LOG_QUEUE_DEPTH];
+static _Atomic uint32_t log_enqueue_pos = 0;
+static uint32_t         log_dequeue_pos = 0;
+static volatile bool    log_is_async = true;
+static volatile bool    log_is_batching = true;
+
+// Messages sent in place are written here, so callers need no buffer of
+// their own. If it is busy, the message is queued instead
+static uint8_t          log_sync_buffer[LOG_SLOT_SIZE_B];
+static atomic_flag      log_sync_busy = ATOMIC_FLAG_INIT;
+static log_isr_ring_t   log_isr_rings[LOG_ISR_RING_COUNT];
+
+// Batch under construction -- owned by the logger thread
+static uint8_t          log_batch[LOG_BATCH_MAX_B];
+static uint16_t         log_batch_length = 0;
+static uint32_t         log_batch_messages = 0;
+static uint32_t         log_batch_started = 0;
+
+static _Atomic uint32_t log_stat_syscalls = 0;
+static _Atomic uint32_t log_stat_messages = 0;
+static _Atomic uint32_t log_stat_bytes = 0;
+static _Atomic uint32_t log_stat_submitted = 0;
+static _Atomic uint32_t log_stat_dropped = 0;
+static _Atomic uint32_t log_stat_truncated = 0;
+static _Atomic uint32_t log_stat_suppressed = 0;
+static _Atomic uint32_t log_stat_latency_max_us = 0;
+static _Atomic uint32_t log_stat_latency[LOG_LATENCY_BUCKETS];
+
+static osThreadId_t     log_task = NULL;
+static StaticTask_t     log_task_cb;
+static uint64_t         log_task_stack[LOG_TASK_STACK_SIZE_B / sizeof(uint64_t)];
+static const osThreadAttr_t log_task_attributes = {
+    .name = "Log Task",
+    .priority = osPriorityLow,
+    .cb_mem = &log_task_cb,
+    .cb_size = sizeof(log_task_cb),
+    .stack_mem = log_task_stack,
+    .stack_size = sizeof(log_task_stack)
+};
+
+
+/**
+ * @brief Initialize Microvisor application logging and the message queue.
+ *        Call this before any other logging function.
+ */
+void log_init(void) {
+
+    static uint8_t buffer[LOG_BUFFER_SIZE_B] __attribute__ ((aligned(512)));
+    mvServerLoggingInit(buffer, sizeof(buffer));
+
+    for (uint32_t i = 0 ; i < LOG_QUEUE_DEPTH ; ++i) {
+        atomic_init(&log_slots[i].sequence, i);
+    }
+
+    // Interrupt-context records are stamped with the DWT cycle count
+    cycle_counter_init();
+}
+
+
+/**
+ * @brief Create the logger thread. Messages posted before this is called
+ *        are sent synchronously.
+ */
+void log_start_task(void) {
+
+    log_task = osThreadNew(start_log_task, NULL, &log_task_attributes);
+}
+
+
+/**
+ * @brief Choose whether messages are handed to the logger thread (the
+ *        default) or sent from the caller's own context.
+ *
+ * @param is_async `true` to queue messages, `false` to send them in place.
+ */
+void log_set_async(bool is_async) {
+
+    log_is_async = is_async;
+}
+
+
+/**
+ * @brief Choose whether the logger thread packs queued messages into
+ *        batches (the default) or sends each one with its own system call.
+ *
+ * @param is_batching `true` to batch messages.
+ */
+void log_set_batching(bool is_batching) {
+
+    log_is_batching = is_batching;
+}
+
+
+/**
+ * @brief Read the logging pipeline statistics.
+ *
+ * @param stats Filled with the counts since startup.
+ */
+void log_get_stats(log_stats_t* stats) {
+
+    stats->syscalls = atomic_load_explicit(&log_stat_syscalls, memory_order_relaxed);
+    stats->messages = atomic_load_explicit(&log_stat_messages, memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&log_stat_bytes, memory_order_relaxed);
+    stats->submitted = atomic_load_explicit(&log_stat_submitted, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&log_stat_dropped, memory_order_relaxed);
+    stats->truncated = atomic_load_explicit(&log_stat_truncated, memory_order_relaxed);
+    stats->suppressed = atomic_load_explicit(&log_stat_suppressed, memory_order_relaxed);
+    stats->latency_max_us = atomic_load_explicit(&log_stat_latency_max_us, memory_order_relaxed);
+    for (uint32_t i = 0 ; i < LOG_LATENCY_BUCKETS ; ++i) {
+        stats->latency[i] = atomic_load_explicit(&log_stat_latency[i], memory_order_relaxed);
+    }
+}
+
+
+/**
+ * @brief Log the pipeline statistics as two `[HEALTH]` lines: message
+ *        counts, then the `mvServerLog()` latency histogram.
+ */
+void log_report_health(void) {
+
+    log_stats_t stats;
+    log_get_stats(&stats);
+
+    log_info("[HEALTH] submitted %lu dropped %lu truncated %lu suppressed %lu syscalls %lu bytes %lu max %lu us",
+             (unsigned long)stats.submitted, (unsigned long)stats.dropped,
+             (unsigned long)stats.truncated, (unsigned long)stats.suppressed,
+             (unsigned long)stats.syscalls, (unsigned long)stats.bytes,
+             (unsigned long)stats.latency_max_us);
+
+    // One count per histogram bucket, fastest first
+    _Static_assert(LOG_LATENCY_BUCKETS == 8, "Update the histogram report");
+    log_info("[HEALTH] mvServerLog us <32:%lu <64:%lu <128:%lu <256:%lu <512:%lu <1024:%lu <2048:%lu more:%lu",
+             (unsigned long)stats.latency[0], (unsigned long)stats.latency[1],
+             (unsigned long)stats.latency[2], (unsigned long)stats.latency[3],
+             (unsigned long)stats.latency[4], (unsigned long)stats.latency[5],
+             (unsigned long)stats.latency[6], (unsigned long)stats.latency[7]);
+}
+
+
+/**
+ * @brief Queue an unformatted record from interrupt context. Use the
+ *        `server_log_from_isr()` macro rather than calling this directly.
+ *        Each NVIC priority level has its own ring, so handlers never
+ *        contend for one. NMI and HardFault each have a ring too, as they
+ *        can preempt any IRQ, and NMI can preempt HardFault. Thread-mode
+ *        callers share an extra ring and briefly mask interrupts to write
+ *        it. If the ring is full, the record is dropped.
+ *
+ * @param format_string Message string with optional integer formatting
+ * @param arg_count     The number of arguments used, up to `LOG_ISR_ARGS_MAX`
+ * @param arg0..arg2    The arguments
+ */
+void log_isr_post(const char* format_string, uint32_t arg_count, uint32_t arg0, uint32_t arg1, uint32_t arg2) {
+
+    uint64_t timestamp = cycle_counter_read64();
+    uint32_t exception = __get_IPSR();
+    uint32_t primask = 0;
+    uint32_t level;
+
+    if (exception == 0) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        level = LOG_ISR_THREAD_RING;
+    } else if (exception == 2) {
+        // NMI and HardFault have fixed priorities above any IRQ, so they
+        // must not share a ring with priority-0 handlers
+        level = LOG_ISR_NMI_RING;
+    } else if (exception == 3) {
+        level = LOG_ISR_FAULT_RING;
+    } else {
+        level = NVIC_GetPriority((IRQn_Type)((int32_t)exception - 16));
+        if (level >= LOG_ISR_PRIORITY_LEVELS) level = LOG_ISR_PRIORITY_LEVELS - 1;
+    }
+
+    log_isr_ring_t* ring = &log_isr_rings[level];
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_fetch_add_explicit(&log_stat_submitted, 1, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_ISR_RING_DEPTH) {
+        atomic_fetch_add_explicit(&log_stat_dropped, 1, memory_order_relaxed);
+    } else {
+        log_isr_record_t* record = &ring->records[head & LOG_ISR_RING_MASK];
+        record->timestamp = timestamp;
+        record->format_string = format_string;
+        record->arg_count = arg_count;
+        record->args[0] = arg0;
+        record->args[1] = arg1;
+        record->args[2] = arg2;
+        atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    }
+
+    if (exception == 0) {
+        __set_PRIMASK(primask);
+    }
+}
+
+
+#if !LOG_DEFERRED_FORMAT
+
+/**
+ * @brief Issue a text log message. Called by the `server_log()` and
+ *        `server_error()` macros, which supply the call site's state.
+ *
+ * @param site          The call site's flood control state, or `NULL`
+ * @param is_err        Is the message an error?
+ * @param format_string Message string with optional formatting
+ * @param ...           Optional injectable values
+ */
+void log_text(log_site_t* site, bool is_err, const char* format_string, ...) {
+
+    if (site != NULL && !site_take_token(site)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format_string);
+
+#if LOG_REPEAT_SUPPRESSION
+    if (site != NULL) {
+        va_list hash_args;
+        va_copy(hash_args, args);
+        uint32_t hash = hash_text_args(format_string, hash_args);
+        va_end(hash_args);
+
+        if (site_is_repeat(site, hash, is_err, format_string)) {
+            va_end(args);
+            return;
+        }
+    }
+#endif
+
+    post_log(is_err, format_string, args);
+    va_end(args);
+}
+
+
+/**
+ * @brief Issue any log message.
+ *
+ * @param is_err        Is the message an error?
+ * @param format_string Message string with optional formatting
+ * @param args          va_list of args from previous call
+ */
+static void post_log(bool is_err, const char* format_string, va_list args) {
+
+    uint64_t timestamp = cycle_counter_read64();
+
+    log_writer_t writer;
+    char* buffer = (char*)open_message(&writer);
+    if (buffer == NULL) {
+        return;
+    }
+
+    uint32_t length = format_timestamp(buffer, LOG_SLOT_SIZE_B, timestamp);
+    if (is_err) {
+        // Write the message type to the message
+        append_format(buffer, LOG_SLOT_SIZE_B, &length, "[ERROR] ");
+    }
+
+    // Write the formatted text straight into the message's slot
+    if (!append_vformat(buffer, LOG_SLOT_SIZE_B, &length, format_string, args)) {
+        atomic_fetch_add_explicit(&log_stat_truncated, 1, memory_order_relaxed);
+    }
+
+    close_message(&writer, (uint16_t)length, is_err);
+}
+
+
+/**
+ * @brief Write a message's timestamp prefix: seconds and microseconds
+ *        since the cycle counter was started.
+ *
+ * @param buffer    The output buffer.
+ * @param size      The buffer size in bytes.
+ * @param timestamp The cycle count.
+ *
+ * @retval The number of characters written.
+ */
+static uint32_t format_timestamp(char* buffer, uint32_t size, uint64_t timestamp) {
+
+    uint64_t us = cycle_counter_to_us(timestamp);
+    uint32_t length = 0;
+    append_format(buffer, size, &length, "[%lu.%06lu] ", (unsigned long)(us / 1000000U), (unsigned long)(us % 1000000U));
+    return length;
+}
+
+
+/**
+ * @brief Append formatted text to a message, clipped to the buffer.
+ *
+ * @param buffer        The message buffer.
+ * @param size          The buffer size in bytes, including the NUL.
+ * @param length        The message length so far, advanced past the text.
+ * @param format_string Message string with optional formatting.
+ * @param ...           Optional injectable values.
+ *
+ * @retval `true` if the text fit, `false` if it was cut short.
+ */
+static bool append_format(char* buffer, uint32_t size, uint32_t* length, const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    bool fitted = append_vformat(buffer, size, length, format_string, args);
+    va_end(args);
+    return fitted;
+}
+
+
+/**
+ * @brief Append formatted text to a message, clipped to the buffer.
+ *
+ * @param buffer        The message buffer.
+ * @param size          The buffer size in bytes, including the NUL.
+ * @param length        The message length so far, advanced past the text.
+ * @param format_string Message string with optional formatting.
+ * @param args          va_list of args from previous call.
+ *
+ * @retval `true` if the text fit, `false` if it was cut short.
+ */
+static bool append_vformat(char* buffer, uint32_t size, uint32_t* length, const char* format_string, va_list args) {
+
+    uint32_t room = size - *length;
+    uint32_t needed = log_vformat(&buffer[*length], room, format_string, args);
+
+    // log_vformat() returns the untruncated length, and keeps one byte for the NUL
+    *length += (needed < room) ? needed : room - 1;
+    return needed < room;
+}
+
+
+/**
+ * @brief Hash a text message's arguments without formatting it. The format
+ *        string is scanned only to learn each argument's type; strings are
+ *        hashed by content.
+ *
+ * @param format_string Message string with optional formatting
+ * @param args          The message's arguments
+ *
+ * @retval The hash.
+ */
+static uint32_t hash_text_args(const char* format_string, va_list args) {
+
+    uint32_t hash = LOG_HASH_SEED;
+
+    for (const char* p = format_string ; *p != '\0' ; ++p) {
+        if (*p != '%') continue;
+        if (*++p == '%') continue;
+
+        // Flags, width and precision -- '*' takes an int argument
+        uint32_t longs = 0;
+        for ( ; *p != '\0' ; ++p) {
+            if (*p == '*') {
+                int value = va_arg(args, int);
+                hash = hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+            } else if (*p == 'l') {
+                longs++;
+            } else if (strchr("-+ #0123456789.hjzt", *p) == NULL) {
+                break;
+            }
+        }
+
+        if (*p == '\0') break;
+
+        if (*p == 's') {
+            const char* value = va_arg(args, const char*);
+            if (value != NULL) hash = hash_bytes(hash, (const uint8_t*)value, strlen(value));
+        } else if (strchr("eEfFgGaA", *p) != NULL) {
+            double value = va_arg(args, double);
+            hash = hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+        } else if (longs > 1) {
+            long long value = va_arg(args, long long);
+            hash = hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+        } else if (*p == 'p') {
+            void* value = va_arg(args, void*);
+            hash = hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+        } else {
+            long value = (longs == 1) ? va_arg(args, long) : va_arg(args, int);
+            hash = hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+        }
+    }
+
+    return hash;
+}
+
+#else
+
+/**
+ * @brief Start a deferred log record. Called by the `server_log()` and
+ *        `server_error()` macros. If the call site is over its rate limit,
+ *        the record is marked suppressed and the rest of the calls for it
+ *        do nothing.
+ *
+ * @param record    The record to fill.
+ * @param site      The call site's flood control state, or `NULL`
+ * @param is_err    Is the message an error?
+ * @param format_id The call site's format string in the `.log_fmt` section.
+ */
+void log_record_begin(log_record_t* record, log_site_t* site, bool is_err, const char* format_id) {
+
+    record->site = site;
+    record->format_id = format_id;
+    record->is_suppressed = (site != NULL && !site_take_token(site));
+    if (record->is_suppressed) {
+        return;
+    }
+
+    record_start(record, is_err ? LOG_RECORD_FLAG_ERROR : 0, format_id, cycle_counter_read64());
+}
+
+
+/**
+ * @brief Write a deferred record's header: flags, format string ID and
+ *        timestamp.
+ *
+ * @param record    The record to fill.
+ * @param flags     `LOG_RECORD_FLAG_*` bits; the timestamp flag is added.
+ * @param format_id The format string's ID.
+ * @param timestamp The 64-bit cycle count.
+ */
+static void record_start(log_record_t* record, uint8_t flags, const char* format_id, uint64_t timestamp) {
+
+    record->data[0] = flags | LOG_RECORD_FLAG_TIMESTAMP;
+    record->length = 1;
+    record->is_truncated = false;
+    put_varint(record, (uint32_t)(uintptr_t)format_id);
+    put_varint(record, timestamp);
+    record->args_start = record->length;
+}
+
+
+/**
+ * @brief Append one argument to a deferred log record. Integers are sent as
+ *        varints, doubles as their eight raw bytes and strings as a varint
+ *        length followed by the characters.
+ *
+ * @param record       The record to fill.
+ * @param arg_type     One of the `LOG_ARG_*` types.
+ * @param int_value    The argument if it is an integer or a pointer.
+ * @param float_value  The argument if it is floating point.
+ * @param string_value The argument if it is a string.
+ */
+void log_record_put(log_record_t* record, uint32_t arg_type, uint64_t int_value, double float_value, const void* string_value) {
+
+    if (record->is_suppressed) {
+        return;
+    }
+
+    switch (arg_type) {
+        case LOG_ARG_U64:
+            put_varint(record, int_value);
+            break;
+
+        case LOG_ARG_DOUBLE:
+            put_bytes(record, (const uint8_t*)&float_value, sizeof(float_value));
+            break;
+
+        case LOG_ARG_STRING: {
+            // Clip the string to the space left after its length prefix
+            uint32_t length = (string_value != NULL) ? strlen((const char*)string_value) : 0;
+            uint32_t space = LOG_RECORD_MAX_LEN_B - record->length;
+            space = (space > 2) ? space - 2 : 0;
+            if (length > space) {
+                length = space;
+                record->is_truncated = true;
+            }
+
+            put_varint(record, length);
+            put_bytes(record, (const uint8_t*)string_value, length);
+            break;
+        }
+
+        case LOG_ARG_U32:
+        default:
+            put_varint(record, (uint32_t)int_value);
+            break;
+    }
+}
+
+
+/**
+ * @brief Send a completed deferred log record.
+ *
+ * @param record The record to send.
+ */
+void log_record_post(log_record_t* record) {
+
+    if (record->is_suppressed) {
+        return;
+    }
+
+    bool is_err = (record->data[0] & LOG_RECORD_FLAG_ERROR) != 0;
+
+#if LOG_REPEAT_SUPPRESSION
+    // The encoded arguments identify the message, so hash them as they are
+    if (record->site != NULL) {
+        uint32_t hash = hash_bytes(LOG_HASH_SEED, &record->data[record->args_start],
+                                   (uint32_t)(record->length - record->args_start));
+        if (site_is_repeat(record->site, hash, is_err, record->format_id)) {
+            return;
+        }
+    }
+#endif
+
+    if (record->is_truncated) {
+        record->data[0] |= LOG_RECORD_FLAG_TRUNCATED;
+        atomic_fetch_add_explicit(&log_stat_truncated, 1, memory_order_relaxed);
+    }
+
+    submit_message(record->data, record->length, is_err);
+}
+
+
+/**
+ * @brief Append raw bytes to a deferred log record, or mark the record
+ *        truncated if they do not fit.
+ *
+ * @param record The record to fill.
+ * @param data   The bytes to add.
+ * @param length The number of bytes.
+ */
+static void put_bytes(log_record_t* record, const uint8_t* data, uint32_t length) {
+
+    if (record->length + length > LOG_RECORD_MAX_LEN_B) {
+        record->is_truncated = true;
+        return;
+    }
+
+    memcpy(&record->data[record->length], data, length);
+    record->length += length;
+}
+
+
+/**
+ * @brief Append an unsigned LEB128 varint to a deferred log record.
+ *
+ * @param record The record to fill.
+ * @param value  The value to add.
+ */
+static void put_varint(log_record_t* record, uint64_t value) {
+
+    uint8_t bytes[10];
+    uint32_t count = 0;
+
+    do {
+        bytes[count] = value & 0x7F;
+        value >>= 7;
+        if (value != 0) bytes[count] |= 0x80;
+        count++;
+    } while (value != 0);
+
+    put_bytes(record, bytes, count);
+}
+
+
+/**
+ * @brief Render a deferred log record as a text line: a marker character
+ *        followed by the record in unpadded base64.
+ *
+ * @param data   The record.
+ * @param length The record length in bytes.
+ * @param line   Output buffer of at least `LOG_RECORD_LINE_MAX_B` bytes.
+ *
+ * @retval The length of the line.
+ */
+static uint16_t encode_base64(const uint8_t* data, uint16_t length, char* line) {
+
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint16_t out = 0;
+
+    line[out++] = LOG_RECORD_MARKER;
+    for (uint16_t i = 0 ; i < length ; i += 3) {
+        uint32_t remaining = length - i;
+        uint32_t triple = (uint32_t)data[i] << 16;
+        if (remaining > 1) triple |= (uint32_t)data[i + 1] << 8;
+        if (remaining > 2) triple |= data[i + 2];
+
+        line[out++] = alphabet[(triple >> 18) & 0x3F];
+        line[out++] = alphabet[(triple >> 12) & 0x3F];
+        if (remaining > 1) line[out++] = alphabet[(triple >> 6) & 0x3F];
+        if (remaining > 2) line[out++] = alphabet[triple & 0x3F];
+    }
+
+    return out;
+}
+
+#endif /* LOG_DEFERRED_FORMAT */
+
+
+/**
+ * @brief Apply a call site's rate limit. The site's token bucket is
+ *        tracked as debt, so a zeroed site starts with a full bucket.
+ *        Site state is not locked: a site shared by several threads may
+ *        miscount, but it cannot block or crash.
+ *
+ * @param site The call site's flood control state.
+ *
+ * @retval `true` if the message may be sent, `false` if it is suppressed.
+ */
+static bool site_take_token(log_site_t* site) {
+
+#if LOG_RATE_LIMIT_BURST > 0
+    uint32_t now = osKernelGetTickCount();
+    uint32_t tick_freq = osKernelGetTickFreq();
+
+    // Past the time a full bucket takes to refill, waiting longer repays
+    // nothing more, so clamp the elapsed ticks before scaling them
+    uint32_t elapsed = now - site->last_tick;
+    uint32_t refill_ticks = (LOG_RATE_LIMIT_BURST * tick_freq) / LOG_RATE_LIMIT_PER_SEC + 1U;
+    if (elapsed > refill_ticks) elapsed = refill_ticks;
+
+    uint32_t repaid = (uint32_t)(((uint64_t)elapsed * LOG_RATE_LIMIT_PER_SEC * 1000U) / tick_freq);
+    site->last_tick = now;
+    site->debt = (repaid >= site->debt) ? 0 : site->debt - repaid;
+
+    if (site->debt + 1000U > LOG_RATE_LIMIT_BURST * 1000U) {
+        if (site->rate_limited < UINT16_MAX) site->rate_limited++;
+        atomic_fetch_add_explicit(&log_stat_suppressed, 1, memory_order_relaxed);
+        return false;
+    }
+
+    site->debt += 1000U;
+#else
+    (void)site;
+#endif
+
+    return true;
+}
+
+
+/**
+ * @brief Check whether a message repeats the last one sent from its call
+ *        site. When the site sends a different message, or every
+ *        `LOG_REPEAT_SUMMARY_MS` while repeats continue, a summary of the
+ *        suppressed messages is posted first.
+ *
+ * @param site      The call site's flood control state.
+ * @param hash      The hash of the message's arguments.
+ * @param is_err    Is the message an error?
+ * @param format_id The call site's format string.
+ *
+ * @retval `true` if the message is a repeat and should be suppressed.
+ */
+static bool site_is_repeat(log_site_t* site, uint32_t hash, bool is_err, const char* format_id) {
+
+    uint32_t now = osKernelGetTickCount();
+    bool is_repeat = site->has_hash && hash == site->last_hash;
+
+    if (is_repeat) {
+        if (site->repeats < UINT16_MAX) site->repeats++;
+        atomic_fetch_add_explicit(&log_stat_suppressed, 1, memory_order_relaxed);
+    }
+
+    if (site->repeats > 0 || site->rate_limited > 0) {
+        if (!is_repeat || now - site->summary_tick >= LOG_REPEAT_SUMMARY_MS) {
+            post_summary(site, is_err, format_id);
+            site->summary_tick = now;
+        }
+    } else {
+        site->summary_tick = now;
+    }
+
+    site->last_hash = hash;
+    site->has_hash = true;
+    return is_repeat;
+}
+
+
+/**
+ * @brief Report, and reset, a call site's suppressed message counts.
+ *
+ * @param site      The call site's flood control state.
+ * @param is_err    Is the site's message an error?
+ * @param format_id The call site's format string.
+ */
+static void post_summary(log_site_t* site, bool is_err, const char* format_id) {
+
+#if LOG_DEFERRED_FORMAT
+    log_record_t record;
+    record_start(&record, LOG_RECORD_FLAG_SUMMARY | (is_err ? LOG_RECORD_FLAG_ERROR : 0),
+                 format_id, cycle_counter_read64());
+    put_varint(&record, site->repeats);
+    put_varint(&record, site->rate_limited);
+    submit_message(record.data, record.length, is_err);
+#else
+    log_writer_t writer;
+    char* buffer = (char*)open_message(&writer);
+    if (buffer != NULL) {
+        uint32_t length = format_timestamp(buffer, LOG_SLOT_SIZE_B, cycle_counter_read64());
+        append_format(buffer, LOG_SLOT_SIZE_B, &length, "%sLast message repeated %u times, %u more rate limited: %s",
+                      is_err ? "[ERROR] " : "", site->repeats, site->rate_limited, format_id);
+        close_message(&writer, (uint16_t)length, is_err);
+    }
+#endif
+
+    site->repeats = 0;
+    site->rate_limited = 0;
+}
+
+
+/**
+ * @brief Add bytes to an FNV-1a hash.
+ *
+ * @param hash   The hash so far.
+ * @param data   The bytes to add.
+ * @param length The number of bytes.
+ *
+ * @retval The updated hash.
+ */
+static uint32_t hash_bytes(uint32_t hash, const uint8_t* data, uint32_t length) {
+
+    for (uint32_t i = 0 ; i < length ; ++i) {
+        hash = (hash ^ data[i]) * LOG_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief Hand a message to the logger thread, or send it in place if the
+ *        thread is not running or asynchronous logging is off. If the queue
+ *        is full, the message is dropped rather than blocking the caller.
+ *
+ * @param data   The message.
+ * @param length The message length in bytes.
+ * @param is_err Is the message an error?
+ */
+static void submit_message(const uint8_t* data, uint16_t length, bool is_err) {
+
+    log_writer_t writer;
+    uint8_t* buffer = open_message(&writer);
+    if (buffer != NULL) {
+        memcpy(buffer, data, length);
+        close_message(&writer, length, is_err);
+    }
+}
+
+
+/**
+ * @brief Get a buffer of LOG_SLOT_SIZE_B bytes to write a message into:
+ *        the sync buffer if the message is to be sent in place, otherwise
+ *        a reserved queue slot.
+ *
+ * @param writer Filled in for close_message().
+ *
+ * @retval The buffer, or `NULL` if the message must be dropped.
+ */
+static uint8_t* open_message(log_writer_t* writer) {
+
+    writer->slot = NULL;
+    writer->data = NULL;
+    atomic_fetch_add_explicit(&log_stat_submitted, 1, memory_order_relaxed);
+
+    if (!log_is_async || log_task == NULL) {
+        if (!atomic_flag_test_and_set_explicit(&log_sync_busy, memory_order_acquire)) {
+            writer->data = log_sync_buffer;
+            return writer->data;
+        }
+
+        // Another caller is sending in place: queue this one if possible
+        if (log_task == NULL) {
+            atomic_fetch_add_explicit(&log_stat_dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+    }
+
+    writer->slot = reserve_slot();
+    if (writer->slot == NULL) {
+        atomic_fetch_add_explicit(&log_stat_dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    writer->data = writer->slot->data;
+    return writer->data;
+}
+
+
+/**
+ * @brief Finish a message started with open_message(): commit its slot
+ *        and wake the logger thread, or send it in place.
+ *
+ * @param writer The buffer returned by open_message().
+ * @param length The message length in bytes.
+ * @param is_err Is the message an error?
+ */
+static void close_message(log_writer_t* writer, uint16_t length, bool is_err) {
+
+    if (writer->slot == NULL) {
+        send_message(writer->data, length, is_err, false);
+        atomic_flag_clear_explicit(&log_sync_busy, memory_order_release);
+        return;
+    }
+
+    writer->slot->length = length;
+    writer->slot->is_err = is_err;
+    commit_slot(writer->slot);
+    osThreadFlagsSet(log_task, LOG_FLAG_PENDING);
+}
+
+
+/**
+ * @brief Render a message as text and send it, either straight away or
+ *        as part of the logger thread's current batch.
+ *
+ * @param data      The message.
+ * @param length    The message length in bytes.
+ * @param is_err    Is the message an error?
+ * @param may_batch `true` only when called by the logger thread.
+ */
+static void send_message(const uint8_t* data, uint16_t length, bool is_err, bool may_batch) {
+
+#if LOG_DEFERRED_FORMAT
+    char line[LOG_RECORD_LINE_MAX_B];
+    length = encode_base64(data, length, line);
+    data = (const uint8_t*)line;
+#endif
+
+    if (may_batch && log_is_batching) {
+        batch_add(data, length, is_err);
+    } else {
+        write_log(data, length, 1);
+    }
+}
+
+
+/**
+ * @brief Output text using the system call, and count it.
+ *
+ * @param data          The text.
+ * @param length        The text length in bytes.
+ * @param message_count The number of messages the text holds.
+ */
+static void write_log(const uint8_t* data, uint16_t length, uint32_t message_count) {
+
+    uint32_t start = cycle_counter_read();
+    mvServerLog(data, length);
+    uint32_t us = (uint32_t)cycle_counter_to_us(cycle_counter_read() - start);
+
+    // Bucket by power of two above LOG_LATENCY_MIN_US
+    uint32_t bucket = 0;
+    for (uint32_t limit = LOG_LATENCY_MIN_US ; us >= limit && bucket < LOG_LATENCY_BUCKETS - 1 ; limit <<= 1) {
+        bucket++;
+    }
+
+    atomic_fetch_add_explicit(&log_stat_latency[bucket], 1, memory_order_relaxed);
+    uint32_t max = atomic_load_explicit(&log_stat_latency_max_us, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak_explicit(&log_stat_latency_max_us, &max, us,
+                                                              memory_order_relaxed, memory_order_relaxed)) {
+        // `max` was reloaded: try again
+    }
+
+    atomic_fetch_add_explicit(&log_stat_syscalls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&log_stat_messages, message_count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&log_stat_bytes, length, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Add a message to the logger thread's batch, sending the batch
+ *        first if the message will not fit, and afterwards if the message
+ *        is an error. Messages too large for any batch are sent alone.
+ *
+ * @param data   The message text.
+ * @param length The message length in bytes.
+ * @param is_err Is the message an error?
+ */
+static void batch_add(const uint8_t* data, uint16_t length, bool is_err) {
+
+    uint32_t separator = (log_batch_length > 0) ? 1 : 0;
+    if (log_batch_length + separator + length > LOG_BATCH_MAX_B) {
+        batch_flush();
+        separator = 0;
+    }
+
+    if (length > LOG_BATCH_MAX_B) {
+        write_log(data, length, 1);
+        return;
+    }
+
+    if (log_batch_length == 0) {
+        log_batch_started = osKernelGetTickCount();
+    } else {
+        log_batch[log_batch_length++] = '\n';
+    }
+
+    memcpy(&log_batch[log_batch_length], data, length);
+    log_batch_length += length;
+    log_batch_messages++;
+
+    if (is_err) {
+        batch_flush();
+    }
+}
+
+
+/**
+ * @brief Send the logger thread's batch, if it holds anything.
+ */
+static void batch_flush(void) {
+
+    if (log_batch_length > 0) {
+        write_log(log_batch, log_batch_length, log_batch_messages);
+        log_batch_length = 0;
+        log_batch_messages = 0;
+    }
+}
+
+
+/**
+ * @brief How long the logger thread may sleep before it must next act:
+ *        either to send a batch that has reached its deadline, or to poll
+ *        the interrupt-context rings.
+ *
+ * @retval The timeout in ticks.
+ */
+static uint32_t batch_timeout(void) {
+
+    if (log_batch_length == 0) {
+        return LOG_ISR_POLL_MS;
+    }
+
+    uint32_t age = osKernelGetTickCount() - log_batch_started;
+    if (age >= LOG_BATCH_DEADLINE_MS) {
+        return 0;
+    }
+
+    uint32_t remaining = LOG_BATCH_DEADLINE_MS - age;
+    return (remaining < LOG_ISR_POLL_MS) ? remaining : LOG_ISR_POLL_MS;
+}
+
+
+/**
+ * @brief Function implementing the logger thread: sleep until messages
+ *        are queued, then pass them to Microvisor in order.
+ *
+ * @param argument: Not used.
+ */
+static void start_log_task(void *argument) {
+
+    /* Infinite loop */
+    for(;;) {
+        // Interrupt handlers do not signal the thread, so wake periodically
+        // to collect their records. Also wake in time to meet the batch deadline
+        osThreadFlagsWait(LOG_FLAG_PENDING, osFlagsWaitAny, batch_timeout());
+
+        log_slot_t* slot;
+        while ((slot = next_committed_slot()) != NULL) {
+            send_message(slot->data, slot->length, slot->is_err, true);
+            release_slot(slot);
+        }
+
+        drain_isr_rings();
+
+        if (!log_is_batching || batch_timeout() == 0) {
+            batch_flush();
+        }
+    }
+}
+
+
+/**
+ * @brief Send every record waiting in the interrupt-context rings, highest
+ *        priority level first: NMI, HardFault, the NVIC levels, then thread
+ *        mode.
+ */
+static void drain_isr_rings(void) {
+
+    for (uint32_t i = 0 ; i < LOG_ISR_RING_COUNT ; ++i) {
+        // Visit the two fault rings, at the top of the array, first
+        uint32_t level = (i < 2) ? LOG_ISR_NMI_RING + i : i - 2;
+        log_isr_ring_t* ring = &log_isr_rings[level];
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+        while (tail != atomic_load_explicit(&ring->head, memory_order_acquire)) {
+            log_isr_record_t record = ring->records[tail & LOG_ISR_RING_MASK];
+            atomic_store_explicit(&ring->tail, ++tail, memory_order_release);
+            send_isr_record(level, &record);
+        }
+    }
+}
+
+
+/**
+ * @brief Format and send one interrupt-context record.
+ *
+ * @param level  The NVIC priority level it was posted from,
+ *               `LOG_ISR_THREAD_RING` for thread mode, or
+ *               `LOG_ISR_NMI_RING` or `LOG_ISR_FAULT_RING`.
+ * @param record The record.
+ */
+static void send_isr_record(uint32_t level, const log_isr_record_t* record) {
+
+#if LOG_DEFERRED_FORMAT
+    log_record_t out;
+    record_start(&out, LOG_RECORD_FLAG_ISR, record->format_string, record->timestamp);
+    for (uint32_t i = 0 ; i < record->arg_count && i < LOG_ISR_ARGS_MAX ; ++i) {
+        put_varint(&out, record->args[i]);
+    }
+
+    send_message(out.data, out.length, false, true);
+#else
+    char line[LOG_ISR_LINE_MAX_B];
+    uint32_t length = format_timestamp(line, sizeof(line), record->timestamp);
+    if (level == LOG_ISR_NMI_RING) {
+        append_format(line, sizeof(line), &length, "[ISR NMI] ");
+    } else if (level == LOG_ISR_FAULT_RING) {
+        append_format(line, sizeof(line), &length, "[ISR HardFault] ");
+    } else {
+        append_format(line, sizeof(line), &length, "[ISR P%lu] ", (unsigned long)level);
+    }
+    append_format(line, sizeof(line), &length, record->format_string,
+                  record->args[0], record->args[1], record->args[2]);
+
+    send_message((const uint8_t*)line, (uint16_t)length, false, true);
+#endif
+}
+
+
+/**
+ * @brief Claim the next free queue slot. Safe to call from any number of
+ *        threads and interrupts at once: producers race with a single
+ *        compare-and-swap on the enqueue position.
+ *
+ * @retval The reserved slot, or `NULL` if the queue is full.
+ */
+static log_slot_t* reserve_slot(void) {
+
+    uint32_t pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        log_slot_t* slot = &log_slots[pos & LOG_QUEUE_MASK];
+        uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int32_t delta = (int32_t)(sequence - pos);
+
+        if (delta == 0) {
+            // Slot is free at this position -- try to claim it
+            if (atomic_compare_exchange_weak_explicit(&log_enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (delta < 0) {
+            // The logger task has not yet released this slot
+            return NULL;
+        } else {
+            // Another producer got here first
+            pos = atomic_load_explicit(&log_enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+
+/**
+ * @brief Publish a reserved slot to the logger thread.
+ *
+ * @param slot The slot returned by `reserve_slot()`.
+ */
+static void commit_slot(log_slot_t* slot) {
+
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_release);
+}
+
+
+/**
+ * @brief Get the oldest committed message. Only the logger thread calls this.
+ *
+ * @retval The slot, or `NULL` if no message is ready.
+ */
+static log_slot_t* next_committed_slot(void) {
+
+    log_slot_t* slot = &log_slots[log_dequeue_pos & LOG_QUEUE_MASK];
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    return ((int32_t)(sequence - (log_dequeue_pos + 1)) < 0) ? NULL : slot;
+}
+
+
+/**
+ * @brief Return a sent message's slot to the producers.
+ *
+ * @param slot The slot returned by `next_committed_slot()`.
+ */
+static void release_slot(log_slot_t* slot) {
+
+    atomic_store_explicit(&slot->sequence, log_dequeue_pos + LOG_QUEUE_DEPTH, memory_order_release);
+    log_dequeue_pos++;
+}
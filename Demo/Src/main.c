@@ -19,7 +19,11 @@
 #include "stm32u5xx_hal.h"
 // Application
 #include "main.h"
+#include "periodic.h"
 #include "app_version.h"
+#ifdef ENABLE_BENCHMARKS
+#include "benchmark.h"
+#endif
 
 
 /*
@@ -29,8 +33,8 @@ void        SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 void        start_led_task(void *argument);
 void        start_ping_task(void *argument);
-static void post_log(bool is_err, const char* format_string, va_list args);
 static void log_device_info(void);
+static void log_idle_health(void);
 
 
 /*
@@ -47,9 +51,12 @@ osThreadId_t ping_task;
 const osThreadAttr_t ping_task_attributes = {
     .name = "PING Task",
     .priority = osPriorityNormal,
-    .stack_size = 5120
+    .stack_size = PING_TASK_STACK_SIZE_B
 };
 
+static periodic_job_t led_job;
+static periodic_job_t ping_job;
+
 
 /**
  * @brief  The application entry point.
@@ -58,8 +65,7 @@ const osThreadAttr_t ping_task_attributes = {
 int main(void) {
 
     // Initialize application logging
-    static uint8_t buffer[LOG_BUFFER_SIZE_B] __attribute__ ((aligned(512)));
-    mvServerLoggingInit(buffer, sizeof(buffer));
+    log_init();
 
     // Reset all peripherals, initialize the Flash interface and the Systick
     HAL_Init();
@@ -80,6 +86,14 @@ int main(void) {
     led_task  = osThreadNew(start_led_task,  NULL, &led_task_attributes);
     ping_task = osThreadNew(start_ping_task, NULL, &ping_task_attributes);
 
+    // Start the logger thread -- log messages are queued from here on
+    log_start_task();
+
+#ifdef ENABLE_BENCHMARKS
+    // Run the benchmarks once the scheduler is up
+    benchmark_start_task();
+#endif
+
     // Start the RTOS scheduler
     osKernelStart();
 
@@ -144,11 +158,13 @@ static void MX_GPIO_Init(void) {
  */
 void start_led_task(void *argument) {
 
+    periodic_init(&led_job, LED_PAUSE_MS);
+
     /* Infinite loop */
     for(;;) {
         // Toggle GPIO PA5 -- the NDB's USER LED
         HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);
-        osDelay(LED_PAUSE_MS);
+        periodic_wait(&led_job);
     }
 }
 
@@ -161,11 +177,20 @@ void start_led_task(void *argument) {
 void start_ping_task(void *argument) {
 
     uint32_t count = 0;
+    periodic_init(&ping_job, PING_PAUSE_MS);
 
     /* Infinite loop */
     for(;;) {
-        server_log("Ping %u", count++);
-        osDelay(PING_PAUSE_MS);
+        log_info("Ping %lu", (unsigned long)count);
+        count++;
+        if (count % HEALTH_REPORT_PINGS == 0) {
+            log_report_health();
+            periodic_report("LED", &led_job);
+            periodic_report("Ping", &ping_job);
+            log_idle_health();
+        }
+
+        periodic_wait(&ping_job);
     }
 }
 
@@ -179,75 +204,50 @@ void Error_Handler(void) {
 
     /* You can add your own implementation to
        report the HAL error return state */
-    server_error("STM32 HAL error");
-}
-
-
-/**
- * @brief Issue a debug message.
- *
- * @param format_string Message string with optional formatting
- * @param ...           Optional injectable values
- */
-void server_log(const char* format_string, ...) {
-
-    va_list args;
-    va_start(args, format_string);
-    post_log(false, format_string, args);
-    va_end(args);
+    log_error("STM32 HAL error");
 }
 
 
 /**
- * @brief Issue an error message.
- *
- * @param format_string Message string with optional formatting
- * @param ...           Optional injectable values
+ * @brief Show basic device info.
  */
-void server_error(const char* format_string, ...) {
+static void log_device_info(void) {
 
-    va_list args;
-    va_start(args, format_string);
-    post_log(true, format_string, args);
-    va_end(args);
+    uint8_t dev_id[35] = { 0 };
+    mvGetDeviceId(dev_id, 34);
+    log_info("Device: %s", dev_id);
+    log_info("App: %s %s (BUILD %i)", APP_NAME, APP_VERSION, BUILD_NUM);
+    log_debug("Heap free: %u bytes", (unsigned)xPortGetFreeHeapSize());
 }
 
 
 /**
- * @brief Issue any log message.
- *
- * @param is_err        Is the message an error?
- * @param format_string Message string with optional formatting
- * @param args          va_list of args from previous call
+ * @brief Log how the kernel has idled since the last call as a `[HEALTH]`
+ *        line: wake-ups from tickless sleep per second, and the share of
+ *        the time spent asleep.
  */
-static void post_log(bool is_err, const char* format_string, va_list args) {
+static void log_idle_health(void) {
 
-    char buffer[LOG_MESSAGE_MAX_LEN_B] = {0};
-    uint32_t buffer_delta = 0;
+    static osKernelIdleStats_t last_stats;
+    static uint64_t last_count;
 
-    if (is_err) {
-        // Write the message type to the message
-        sprintf(buffer, "[ERROR] ");
-        buffer_delta = 8;
-    }
+    osKernelIdleStats_t stats;
+    osKernelGetIdleStats(&stats);
+    uint64_t count = osKernelGetSysTimerCount64();
 
-    // Write the formatted text to the message
-    vsnprintf(&buffer[buffer_delta], sizeof(buffer) - buffer_delta - 1, format_string, args);
-
-    // Output the message using the system call
-    mvServerLog((const uint8_t*)buffer, (uint16_t)strlen(buffer));
-}
+    uint64_t elapsed = count - last_count;
+    uint64_t elapsed_ms = osKernelSysTimerToNs(elapsed) / 1000000;
+    uint32_t wakeups = stats.sleeps - last_stats.sleeps;
+    uint32_t asleep_permille = (uint32_t)(((stats.sleep_time - last_stats.sleep_time) * 1000) / (elapsed > 0 ? elapsed : 1));
 
+    log_info("[HEALTH] idle: %lu wakeups/s, asleep %lu.%lu%%, %lu woken early, %lu aborted",
+             (unsigned long)((uint64_t)wakeups * 1000 / (elapsed_ms > 0 ? elapsed_ms : 1)),
+             (unsigned long)(asleep_permille / 10), (unsigned long)(asleep_permille % 10),
+             (unsigned long)(stats.early - last_stats.early),
+             (unsigned long)(stats.aborted - last_stats.aborted));
 
-/**
- * @brief Show basic device info.
- */
-static void log_device_info(void) {
-
-    uint8_t dev_id[35] = { 0 };
-    mvGetDeviceId(dev_id, 34);
-    server_log("Device: %s", dev_id);
-    server_log("App: %s %s (BUILD %i)", APP_NAME, APP_VERSION, BUILD_NUM);
+    last_stats = stats;
+    last_count = count;
 }
 
 
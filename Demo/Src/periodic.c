@@ -0,0 +1,131 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+// Microvisor + HAL
+#include "cmsis_os.h"
+// Application
+#include "logging.h"
+#include "periodic.h"
+#include "cycle_counter.h"
+
+
+/**
+ * @brief Set up a periodic job. Call this from the thread that runs the
+ *        job: the current tick is taken as its first release.
+ *
+ * @param job       The job to set up.
+ * @param period_ms The period in milliseconds, rounded up to whole ticks.
+ */
+void periodic_init(periodic_job_t* job, uint32_t period_ms) {
+
+    uint32_t tick_freq = osKernelGetTickFreq();
+    uint64_t period_ticks = ((uint64_t)period_ms * tick_freq + 999) / 1000;
+
+    memset(job, 0, sizeof(periodic_job_t));
+    job->period_ticks = period_ticks > 0 ? (uint32_t)period_ticks : 1;
+    job->period_us = (uint32_t)(((uint64_t)job->period_ticks * 1000000) / tick_freq);
+    job->release_tick = osKernelGetTickCount();
+    job->start_cycles = cycle_counter_read64();
+}
+
+
+/**
+ * @brief Block until the job's next release. Releases fall at whole
+ *        multiples of the period from the first, however long the job
+ *        takes to run, so the schedule does not drift. If the job has
+ *        overrun and one or more releases are already past, those are
+ *        dropped and the job waits for the next one still to come.
+ *
+ * @param job The job.
+ *
+ * @retval `true` if the job met its schedule, `false` if releases were dropped.
+ */
+bool periodic_wait(periodic_job_t* job) {
+
+    uint32_t release = job->release_tick + job->period_ticks;
+    uint32_t missed = 0;
+
+    // Past releases are skipped rather than run back to back
+    uint32_t now = osKernelGetTickCount();
+    if ((int32_t)(release - now) < 0) {
+        missed = (now - release) / job->period_ticks + 1;
+        release += missed * job->period_ticks;
+    }
+
+    // Returns at once if the release is due this tick
+    osDelayUntil(release);
+
+    // Lateness: ticks from the release to running. Jitter: how far this
+    // start is from one period, plus any dropped, after the last
+    uint32_t lateness = osKernelGetTickCount() - release;
+    uint64_t start = cycle_counter_read64();
+    uint64_t interval_us = cycle_counter_to_us(start - job->start_cycles);
+    uint64_t nominal_us = (uint64_t)job->period_us * (missed + 1);
+    uint64_t jitter_us = interval_us > nominal_us ? interval_us - nominal_us : nominal_us - interval_us;
+    if (jitter_us > UINT32_MAX) jitter_us = UINT32_MAX;
+
+    job->release_tick = release;
+    job->start_cycles = start;
+
+    // Keep the statistics consistent for readers in other threads
+    int32_t lock = osKernelLock();
+    periodic_stats_t* stats = &job->stats;
+    stats->releases++;
+    if (missed > 0) {
+        stats->overruns++;
+        stats->skipped += missed;
+    }
+
+    if (lateness > stats->lateness_max_ticks) stats->lateness_max_ticks = lateness;
+    stats->lateness_total_ticks += lateness;
+    if (jitter_us > stats->jitter_max_us) stats->jitter_max_us = (uint32_t)jitter_us;
+    stats->jitter_total_us += (uint32_t)jitter_us;
+    osKernelRestoreLock(lock);
+
+    return (missed == 0);
+}
+
+
+/**
+ * @brief Get a snapshot of a job's release timing statistics. Safe to
+ *        call from any thread.
+ *
+ * @param job   The job.
+ * @param stats Where to write the statistics.
+ */
+void periodic_get_stats(const periodic_job_t* job, periodic_stats_t* stats) {
+
+    int32_t lock = osKernelLock();
+    *stats = job->stats;
+    osKernelRestoreLock(lock);
+}
+
+
+/**
+ * @brief Log a job's release timing statistics as a `[HEALTH]` line.
+ *
+ * @param name The job's name.
+ * @param job  The job.
+ */
+void periodic_report(const char* name, const periodic_job_t* job) {
+
+    periodic_stats_t stats;
+    periodic_get_stats(job, &stats);
+
+    uint32_t releases = stats.releases > 0 ? stats.releases : 1;
+    log_info("[HEALTH] %s job: releases %lu overruns %lu skipped %lu late max %lu avg %lu ticks jitter max %lu avg %lu us",
+             name, (unsigned long)stats.releases,
+             (unsigned long)stats.overruns, (unsigned long)stats.skipped,
+             (unsigned long)stats.lateness_max_ticks,
+             (unsigned long)(stats.lateness_total_ticks / releases),
+             (unsigned long)stats.jitter_max_us,
+             (unsigned long)(stats.jitter_total_us / releases));
+}
@@ -37,6 +37,10 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32u5xx_hal.h"
 #include "mv_syscalls.h"
+#include "cmsis_os.h"
+#ifdef ENABLE_BENCHMARKS
+#include "benchmark.h"
+#endif
 
 /** @addtogroup STM32U5xx_HAL_Driver
   * @{
@@ -48,12 +52,17 @@
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define TIMEBASE_PERIOD_US    1000U
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static TIM_HandleTypeDef        TimHandle;
+static uint32_t                 SleepStartCount;
+static uint64_t                 SleepStartTime;
 
 /* Private function prototypes -----------------------------------------------*/
 void TIM6_IRQHandler(void);
+void TimeBase_SleepEnter(void);
+void TimeBase_SleepExit(void);
 #if (USE_HAL_TIM_REGISTER_CALLBACKS == 1U)
 void TimeBase_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
 #endif
@@ -161,6 +170,63 @@ void HAL_ResumeTick(void)
   __HAL_TIM_ENABLE_IT(&TimHandle, TIM_IT_UPDATE);
 }
 
+/**
+  * @brief  Suspend Tick increment while the RTOS sleeps through idle ticks.
+  * @note   Called with interrupts disabled before the kernel sleeps
+  *         (configPRE_SLEEP_PROCESSING). TIM6 keeps counting, so only its
+  *         update interrupt is stopped, and where it was is noted.
+  * @param  None
+  * @retval None
+  */
+void TimeBase_SleepEnter(void)
+{
+  HAL_SuspendTick();
+
+  SleepStartCount = TimHandle.Instance->CNT;
+  SleepStartTime = osKernelGetSysTimerCount64();
+
+  /* Count an update still waiting for its interrupt, unless the counter
+     wrapped just now and the update is one the sleep will count */
+  if (__HAL_TIM_GET_FLAG(&TimHandle, TIM_FLAG_UPDATE) != RESET)
+  {
+    if (TimHandle.Instance->CNT >= SleepStartCount)
+    {
+      HAL_IncTick();
+    }
+    __HAL_TIM_CLEAR_FLAG(&TimHandle, TIM_FLAG_UPDATE);
+    /* The update is counted: drop its pending interrupt too, or WFI would
+       return at once and the sleep would be lost */
+    HAL_NVIC_ClearPendingIRQ(TIM6_IRQn);
+  }
+}
+
+/**
+  * @brief  Resume Tick increment after the RTOS has slept.
+  * @note   Called with interrupts disabled once the kernel has woken
+  *         (configPOST_SLEEP_PROCESSING). Adds the TIM6 updates missed
+  *         while asleep to the tick: the time slept, taken from the system
+  *         timer, plus the counter's movement, in whole periods.
+  * @param  None
+  * @retval None
+  */
+void TimeBase_SleepExit(void)
+{
+  uint32_t count = TimHandle.Instance->CNT;
+  uint64_t slept_us = osKernelSysTimerToNs(osKernelGetSysTimerCount64() - SleepStartTime) / 1000U;
+  uint32_t updates = (uint32_t)((SleepStartCount + slept_us - count + (TIMEBASE_PERIOD_US / 2U)) / TIMEBASE_PERIOD_US);
+
+  uwTick += updates * uwTickFreq;
+
+  /* The update flag now stands for updates counted above, unless the
+     counter has wrapped again since it was read */
+  if (TimHandle.Instance->CNT >= count)
+  {
+    __HAL_TIM_CLEAR_FLAG(&TimHandle, TIM_FLAG_UPDATE);
+  }
+
+  HAL_ResumeTick();
+}
+
 /**
   * @brief  Period elapsed callback in non blocking mode
   * @note   This function is called  when TIM6 interrupt took place, inside
@@ -181,6 +247,11 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 
   // should we limit this to if (htim->Instance == TIM6) ?
   HAL_IncTick();
+
+#ifdef ENABLE_BENCHMARKS
+  /* Run any benchmark job waiting for interrupt context */
+  bench_tick_isr();
+#endif
 }
 
 /**
@@ -860,19 +860,117 @@ osStatus osSemaphoreDelete (osSemaphoreId semaphore_id)
 
 #if (defined (osFeature_Pool)  &&  (osFeature_Pool != 0)) 
 
-//TODO
-//This is a primitive and inefficient wrapper around the existing FreeRTOS memory management.
-//A better implementation will have to modify heap_x.c!
-
+/* Blocks are tracked in a two-level bitmap. Each block has a bit in freemap,
+   set while the block is free, with block 0 in the top bit of word 0. Each
+   freemap word has a bit in summary, set while that word has a free block.
+   osPoolAlloc finds a free block with one __CLZ on a summary word and one on
+   the freemap word it selects, so it is O(1) up to 1024 blocks and examines
+   one more summary word per further 1024 blocks. osPoolFree is O(1).
+   With configOS1_POOL_PREZERO, a third map marks free blocks that may hold
+   data. osPoolZeroIdle clears them from the idle task, so osPoolCAlloc and
+   osMailCAlloc usually get a block that is already zero. A block stays in
+   the free map while it is zeroed, so a mail queue's free block count
+   always matches the free map. */
+#define POOL_BITS_PER_WORD  32U
+#define POOL_BIT(n)         (0x80000000U >> (n))
+
+#if (configOS1_POOL_PREZERO == 1)
+/* No block is being zeroed */
+#define POOL_NOT_ZEROING    0xFFFFFFFFU
+/* Bytes osPoolZeroIdle zeroes per critical section */
+#define POOL_ZERO_CHUNK     64U
+#endif
 
 typedef struct os_pool_cb {
   void *pool;
-  uint8_t *markers;
+  uint32_t *freemap;
+  uint32_t *summary;
   uint32_t pool_sz;
   uint32_t item_sz;
-  uint32_t currentIndex;
+  uint32_t summary_words;
+#if (configOS1_POOL_PREZERO == 1)
+  uint32_t *dirty;
+  struct os_pool_cb *next;
+  uint32_t zeroing;
+#endif
 } os_pool_cb_t;
 
+#if (configOS1_POOL_PREZERO == 1)
+/* Pools for osPoolZeroIdle to visit */
+static os_pool_cb_t *zeroPools = NULL;
+#endif
+
+
+/* Zero a pool block. Blocks are word aligned and a multiple of 4 bytes long,
+   so this clears four words per step, then any remaining words. */
+static void poolZeroBlock (void *block, uint32_t size)
+{
+  uint32_t *p = (uint32_t *)block;
+  uint32_t *end = p + (size / sizeof(uint32_t));
+  
+  while ((end - p) >= 4) {
+    p[0] = 0;
+    p[1] = 0;
+    p[2] = 0;
+    p[3] = 0;
+    p += 4;
+  }
+  while (p < end) {
+    *p++ = 0;
+  }
+}
+
+/* Zero a block just taken from a pool, unless the idle task has already. */
+static void poolClearBlock (osPoolId pool_id, void *block)
+{
+#if (configOS1_POOL_PREZERO == 1)
+  uint32_t index = ((uint32_t)block - (uint32_t)(pool_id->pool)) / pool_id->item_sz;
+  
+  /* The block is allocated, so nothing else updates its dirty bit */
+  if ((pool_id->dirty[index / POOL_BITS_PER_WORD] & POOL_BIT(index % POOL_BITS_PER_WORD)) == 0) {
+    return;
+  }
+#endif
+  
+  poolZeroBlock(block, pool_id->item_sz);
+}
+
+
+/* Set up a pool's bitmaps so that every block is free. The bitmap holds
+   the free map, then the summary and, with configOS1_POOL_PREZERO, the
+   dirty map, osPoolBitmapWords(pool_sz) words in all. */
+static void poolInit (os_pool_cb_t *thePool, uint32_t pool_sz, uint32_t itemSize, void *pool, uint32_t *bitmap)
+{
+  uint32_t mapWords = osPoolMapWords(pool_sz);
+  uint32_t i;
+  
+  thePool->pool = pool;
+  thePool->pool_sz = pool_sz;
+  thePool->item_sz = itemSize;
+  thePool->summary_words = (mapWords + POOL_BITS_PER_WORD - 1) / POOL_BITS_PER_WORD;
+  thePool->freemap = bitmap;
+  thePool->summary = &bitmap[mapWords];
+  
+  /* Every block starts free; bits past the last block stay clear */
+  memset(bitmap, 0, osPoolBitmapWords(pool_sz) * sizeof(uint32_t));
+  for (i = 0; i < pool_sz; i++) {
+    thePool->freemap[i / POOL_BITS_PER_WORD] |= POOL_BIT(i % POOL_BITS_PER_WORD);
+  }
+  for (i = 0; i < mapWords; i++) {
+    thePool->summary[i / POOL_BITS_PER_WORD] |= POOL_BIT(i % POOL_BITS_PER_WORD);
+  }
+#if (configOS1_POOL_PREZERO == 1)
+  /* Every block starts zeroed, and so clean */
+  thePool->dirty = &thePool->summary[thePool->summary_words];
+  thePool->zeroing = POOL_NOT_ZEROING;
+  poolZeroBlock(pool, pool_sz * itemSize);
+  
+  vPortEnterCritical();
+  thePool->next = zeroPools;
+  zeroPools = thePool;
+  vPortExitCritical();
+#endif
+}
 
 /**
 * @brief Create and Initialize a memory pool
@@ -882,34 +980,44 @@ typedef struct os_pool_cb {
 */
 osPoolId osPoolCreate (const osPoolDef_t *pool_def)
 {
+  uint32_t itemSize = 4 * ((pool_def->item_sz + 3) / 4);
+  
+  if (pool_def->pool_sz == 0) {
+    return NULL;
+  }
+  
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+  if ((pool_def->pool != NULL) && (pool_def->bitmap != NULL) && (pool_def->controlblock != NULL)) {
+    /* osStaticPoolDef_t stands in for the control block in cmsis_os.h */
+    configASSERT(sizeof(osStaticPoolDef_t) == sizeof(os_pool_cb_t));
+    
+    poolInit((os_pool_cb_t *)pool_def->controlblock, pool_def->pool_sz, itemSize, pool_def->pool, pool_def->bitmap);
+    return (osPoolId)pool_def->controlblock;
+  }
+#endif
+  
 #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
   osPoolId thePool;
-  int itemSize = 4 * ((pool_def->item_sz + 3) / 4);
-  uint32_t i;
+  uint32_t *bitmap;
+  void *pool;
   
   /* First have to allocate memory for the pool control block. */
  thePool = pvPortMalloc(sizeof(os_pool_cb_t));
 
   
   if (thePool) {
-    thePool->pool_sz = pool_def->pool_sz;
-    thePool->item_sz = itemSize;
-    thePool->currentIndex = 0;
-    
-    /* Memory for markers */
-    thePool->markers = pvPortMalloc(pool_def->pool_sz);
+    /* Memory for the bitmaps */
+    bitmap = pvPortMalloc(osPoolBitmapWords(pool_def->pool_sz) * sizeof(uint32_t));
    
-    if (thePool->markers) {
+    if (bitmap) {
       /* Now allocate the pool itself. */
-     thePool->pool = pvPortMalloc(pool_def->pool_sz * itemSize);
+     pool = pvPortMalloc(pool_def->pool_sz * itemSize);
       
-      if (thePool->pool) {
-        for (i = 0; i < pool_def->pool_sz; i++) {
-          thePool->markers[i] = 0;
-        }
+      if (pool) {
+        poolInit(thePool, pool_def->pool_sz, itemSize, pool, bitmap);
       }
       else {
-        vPortFree(thePool->markers);
+        vPortFree(bitmap);
         vPortFree(thePool);
         thePool = NULL;
       }
@@ -937,9 +1045,14 @@ void *osPoolAlloc (osPoolId pool_id)
 {
   int dummy = 0;
   void *p = NULL;
-  uint32_t i;
+  uint32_t s;
+  uint32_t word;
   uint32_t index;
   
+  if (pool_id == NULL) {
+    return NULL;
+  }
+  
   if (inHandlerMode()) {
     dummy = portSET_INTERRUPT_MASK_FROM_ISR();
   }
@@ -947,13 +1060,24 @@ void *osPoolAlloc (osPoolId pool_id)
     vPortEnterCritical();
   }
   
-  for (i = 0; i < pool_id->pool_sz; i++) {
-    index = (pool_id->currentIndex + i) % pool_id->pool_sz;
-    
-    if (pool_id->markers[index] == 0) {
-      pool_id->markers[index] = 1;
+  for (s = 0; s < pool_id->summary_words; s++) {
+    if (pool_id->summary[s] != 0) {
+      word = (s * POOL_BITS_PER_WORD) + __CLZ(pool_id->summary[s]);
+      index = __CLZ(pool_id->freemap[word]);
+      
+      pool_id->freemap[word] &= ~POOL_BIT(index);
+      if (pool_id->freemap[word] == 0) {
+        pool_id->summary[s] &= ~POOL_BIT(word % POOL_BITS_PER_WORD);
+      }
+      
+      index += word * POOL_BITS_PER_WORD;
       p = (void *)((uint32_t)(pool_id->pool) + (index * pool_id->item_sz));
-      pool_id->currentIndex = index;
+#if (configOS1_POOL_PREZERO == 1)
+      /* Stop osPoolZeroIdle writing to the block; it is still marked dirty */
+      if (pool_id->zeroing == index) {
+        pool_id->zeroing = POOL_NOT_ZEROING;
+      }
+#endif
       break;
     }
   }
@@ -980,7 +1104,7 @@ void *osPoolCAlloc (osPoolId pool_id)
   
   if (p != NULL)
   {
-    memset(p, 0, sizeof(pool_id->pool_sz));
+    poolClearBlock(pool_id, p);
   }
   
   return p;
@@ -995,7 +1119,10 @@ void *osPoolCAlloc (osPoolId pool_id)
 */
 osStatus osPoolFree (osPoolId pool_id, void *block)
 {
+  int dummy = 0;
+  osStatus status = osOK;
   uint32_t index;
+  uint32_t word;
   
   if (pool_id == NULL) {
     return osErrorParameter;
@@ -1017,12 +1144,100 @@ osStatus osPoolFree (osPoolId pool_id, void *block)
   if (index >= pool_id->pool_sz) {
     return osErrorParameter;
   }
+  word = index / POOL_BITS_PER_WORD;
+  
+  if (inHandlerMode()) {
+    dummy = portSET_INTERRUPT_MASK_FROM_ISR();
+  }
+  else {
+    vPortEnterCritical();
+  }
   
-  pool_id->markers[index] = 0;
+  /* A block that is already free is being returned twice */
+  if (pool_id->freemap[word] & POOL_BIT(index % POOL_BITS_PER_WORD)) {
+    status = osErrorParameter;
+  }
+  else {
+    pool_id->freemap[word] |= POOL_BIT(index % POOL_BITS_PER_WORD);
+    pool_id->summary[word / POOL_BITS_PER_WORD] |= POOL_BIT(word % POOL_BITS_PER_WORD);
+#if (configOS1_POOL_PREZERO == 1)
+    pool_id->dirty[word] |= POOL_BIT(index % POOL_BITS_PER_WORD);
+#endif
+  }
   
-  return osOK;
+  if (inHandlerMode()) {
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(dummy);
+  }
+  else {
+    vPortExitCritical();
+  }
+  
+  return status;
 }
 
+#if (configOS1_POOL_PREZERO == 1)
+/**
+* @brief Zero one freed memory pool block, so that osPoolCAlloc and osMailCAlloc
+*        can hand it out without clearing it. Call from the idle hook.
+* @retval none.
+*/
+void osPoolZeroIdle (void)
+{
+  os_pool_cb_t *pool;
+  uint8_t *block;
+  uint32_t mapWords;
+  uint32_t word;
+  uint32_t bits;
+  uint32_t index;
+  uint32_t done;
+  uint32_t n;
+  
+  for (pool = zeroPools; pool != NULL; pool = pool->next) {
+    mapWords = (pool->pool_sz + POOL_BITS_PER_WORD - 1) / POOL_BITS_PER_WORD;
+    
+    for (word = 0; word < mapWords; word++) {
+      /* Pick a free, dirty block. It stays free: osPoolAlloc may still
+         hand it out, and then stops the zeroing below. */
+      index = 0;
+      vPortEnterCritical();
+      bits = pool->freemap[word] & pool->dirty[word];
+      if (bits != 0) {
+        index = __CLZ(bits);
+        pool->zeroing = (word * POOL_BITS_PER_WORD) + index;
+      }
+      vPortExitCritical();
+      
+      if (bits != 0) {
+        block = (uint8_t *)((uint32_t)(pool->pool) + (((word * POOL_BITS_PER_WORD) + index) * pool->item_sz));
+        
+        /* Zero a chunk at a time, while the block is still free */
+        for (done = 0; done < pool->item_sz; done += n) {
+          n = pool->item_sz - done;
+          if (n > POOL_ZERO_CHUNK) {
+            n = POOL_ZERO_CHUNK;
+          }
+          
+          vPortEnterCritical();
+          if (pool->zeroing == (word * POOL_BITS_PER_WORD) + index) {
+            poolZeroBlock(block + done, n);
+          }
+          vPortExitCritical();
+        }
+        
+        vPortEnterCritical();
+        if (pool->zeroing == (word * POOL_BITS_PER_WORD) + index) {
+          pool->dirty[word] &= ~POOL_BIT(index);
+          pool->zeroing = POOL_NOT_ZEROING;
+        }
+        vPortExitCritical();
+        
+        /* One block per call keeps the idle task responsive */
+        return;
+      }
+    }
+  }
+}
+#endif
 
 #endif   /* Use Memory Pool Management */
 
@@ -1152,9 +1367,14 @@ osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec)
 #if (defined (osFeature_MailQ)  &&  (osFeature_MailQ != 0))  /* Use Mail Queues */
 
 
+/* free_blocks counts the pool's free blocks. osMailAlloc takes a count before
+   it takes a block, so a producer facing an empty pool sleeps on the
+   semaphore's wait list until osMailFree gives one back, or until its
+   timeout expires. Waiters are woken in priority order. */
 typedef struct os_mailQ_cb {
   const osMailQDef_t *queue_def;
   QueueHandle_t handle;
+  SemaphoreHandle_t free_blocks;
   osPoolId pool;
 } os_mailQ_cb_t;
 
@@ -1167,9 +1387,28 @@ typedef struct os_mailQ_cb {
 */
 osMailQId osMailCreate (const osMailQDef_t *queue_def, osThreadId thread_id)
 {
-#if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
   (void) thread_id;
   
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+  if ((queue_def->controlblock != NULL) && (queue_def->buffer != NULL) &&
+      (queue_def->pool != NULL) && (queue_def->bitmap != NULL)) {
+    osStaticMailQDef_t *storage = queue_def->controlblock;
+    osPoolDef_t static_pool_def = {queue_def->queue_sz, queue_def->item_sz, queue_def->pool, queue_def->bitmap, &storage->pool};
+    
+    /* storage->mail stands in for the control block in cmsis_os.h */
+    configASSERT(sizeof(storage->mail) == sizeof(os_mailQ_cb_t));
+    
+    *(queue_def->cb) = (struct os_mailQ_cb *)&storage->mail;
+    (*(queue_def->cb))->queue_def = queue_def;
+    (*(queue_def->cb))->handle = xQueueCreateStatic(queue_def->queue_sz, sizeof(void *), queue_def->buffer, &storage->queue);
+    (*(queue_def->cb))->free_blocks = xSemaphoreCreateCountingStatic(queue_def->queue_sz, queue_def->queue_sz, &storage->free_blocks);
+    (*(queue_def->cb))->pool = osPoolCreate(&static_pool_def);
+    
+    return *(queue_def->cb);
+  }
+#endif
+  
+#if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
   osPoolDef_t pool_def = {queue_def->queue_sz, queue_def->item_sz, NULL};
   
   /* Create a mail queue control block */
@@ -1190,10 +1429,19 @@ osMailQId osMailCreate (const osMailQDef_t *queue_def, osThreadId thread_id)
     return NULL;
   }
   
+  /* Create the count of free blocks that producers wait on */
+  (*(queue_def->cb))->free_blocks = xSemaphoreCreateCounting(queue_def->queue_sz, queue_def->queue_sz);
+  if ((*(queue_def->cb))->free_blocks == NULL) {
+    vQueueDelete((*(queue_def->cb))->handle);
+    vPortFree(*(queue_def->cb));
+    return NULL;
+  }
+  
   /* Create a mail pool */
   (*(queue_def->cb))->pool = osPoolCreate(&pool_def);
   if ((*(queue_def->cb))->pool == NULL) {
-    //TODO: Delete queue. How to do it in FreeRTOS?
+    vSemaphoreDelete((*(queue_def->cb))->free_blocks);
+    vQueueDelete((*(queue_def->cb))->handle);
     vPortFree(*(queue_def->cb));
     return NULL;
   }
@@ -1213,7 +1461,8 @@ osMailQId osMailCreate (const osMailQDef_t *queue_def, osThreadId thread_id)
 */
 void *osMailAlloc (osMailQId queue_id, uint32_t millisec)
 {
-  (void) millisec;
+  portBASE_TYPE taskWoken;
+  TickType_t ticks;
   void *p;
   
   
@@ -1221,6 +1470,32 @@ void *osMailAlloc (osMailQId queue_id, uint32_t millisec)
     return NULL;
   }
   
+  taskWoken = pdFALSE;
+  
+  ticks = 0;
+  if (millisec == osWaitForever) {
+    ticks = portMAX_DELAY;
+  }
+  else if (millisec != 0) {
+    ticks = millisec / portTICK_PERIOD_MS;
+    if (ticks == 0) {
+      ticks = 1;
+    }
+  }
+  
+  /* Holding a count guarantees a free block */
+  if (inHandlerMode()) {
+    if (xSemaphoreTakeFromISR(queue_id->free_blocks, &taskWoken) != pdTRUE) {
+      return NULL;
+    }
+    portEND_SWITCHING_ISR(taskWoken);
+  }
+  else {
+    if (xSemaphoreTake(queue_id->free_blocks, ticks) != pdTRUE) {
+      return NULL;
+    }
+  }
+  
   p = osPoolAlloc(queue_id->pool);
   
   return p;
@@ -1235,13 +1510,10 @@ void *osMailAlloc (osMailQId queue_id, uint32_t millisec)
 */
 void *osMailCAlloc (osMailQId queue_id, uint32_t millisec)
 {
-  uint32_t i;
   void *p = osMailAlloc(queue_id, millisec);
   
   if (p) {
-    for (i = 0; i < queue_id->queue_def->item_sz; i++) {
-      ((uint8_t *)p)[i] = 0;
-    }
+    poolClearBlock(queue_id->pool, p);
   }
   
   return p;
@@ -1345,11 +1617,30 @@ osEvent osMailGet (osMailQId queue_id, uint32_t millisec)
 */
 osStatus osMailFree (osMailQId queue_id, void *mail)
 {
+  portBASE_TYPE taskWoken;
+  osStatus status;
+  
   if (queue_id == NULL) {
     return osErrorParameter;
   }
   
-  return osPoolFree(queue_id->pool, mail);
+  status = osPoolFree(queue_id->pool, mail);
+  if (status != osOK) {
+    return status;
+  }
+  
+  /* Wake the highest priority producer waiting for a block */
+  taskWoken = pdFALSE;
+  
+  if (inHandlerMode()) {
+    xSemaphoreGiveFromISR(queue_id->free_blocks, &taskWoken);
+    portEND_SWITCHING_ISR(taskWoken);
+  }
+  else {
+    xSemaphoreGive(queue_id->free_blocks);
+  }
+  
+  return osOK;
 }
 #endif  /* Use Mail Queues */
 
@@ -272,6 +272,46 @@ typedef StaticQueue_t              osStaticMessageQDef_t;
 
 #endif
 
+#ifndef configOS1_POOL_PREZERO
+#define configOS1_POOL_PREZERO  0       ///< 1=freed pool blocks are zeroed by \ref osPoolZeroIdle
+#endif
+
+/// Words of pool memory for one block of the given type.
+#define osPoolItemWords(type)   ((sizeof(type) + 3U) / 4U)
+
+/// Words of bitmap for a pool of no blocks: a free map, its summary and, with
+/// \ref configOS1_POOL_PREZERO, a map of blocks still to be zeroed.
+#define osPoolMapWords(no)      (((no) + 31U) / 32U)
+#if (configOS1_POOL_PREZERO == 1)
+#define osPoolBitmapWords(no)   ((2U * osPoolMapWords(no)) + ((osPoolMapWords(no) + 31U) / 32U))
+#else
+#define osPoolBitmapWords(no)   (osPoolMapWords(no) + ((osPoolMapWords(no) + 31U) / 32U))
+#endif
+
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+/// Storage for a memory pool control block; the same size as the private os_pool_cb.
+typedef struct {
+  void                   *dummy1[3];
+  uint32_t                dummy2[3];
+#if (configOS1_POOL_PREZERO == 1)
+  void                   *dummy3[2];
+  uint32_t                dummy4;
+#endif
+} osStaticPoolDef_t;
+
+/// Storage for a mail queue's control block, message queue, free block count and pool.
+typedef struct {
+  struct {
+    void                 *dummy1[4];
+  }                       mail;
+  StaticQueue_t           queue;
+  StaticSemaphore_t       free_blocks;
+  osStaticPoolDef_t       pool;
+} osStaticMailQDef_t;
+
+#endif
+
 
 
 
@@ -322,6 +362,10 @@ typedef struct os_pool_def  {
   uint32_t                 pool_sz;    ///< number of items (elements) in the pool
   uint32_t                 item_sz;    ///< size of an item
   void                       *pool;    ///< pointer to memory for pool
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+  uint32_t                 *bitmap;    ///< bitmap for static allocation; NULL for dynamic allocation
+  osStaticPoolDef_t        *controlblock;     ///< control block for static allocation; NULL for dynamic allocation
+#endif
 } osPoolDef_t;
 
 /// Definition structure for message queue.
@@ -342,6 +386,12 @@ typedef struct os_mailQ_def  {
   uint32_t                queue_sz;    ///< number of elements in the queue
   uint32_t                 item_sz;    ///< size of an item
   struct os_mailQ_cb **cb;
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+  osStaticMailQDef_t      *controlblock;     ///< control blocks for static allocation; NULL for dynamic allocation
+  uint8_t                 *buffer;      ///< message queue buffer for static allocation; NULL for dynamic allocation
+  uint32_t                *pool;        ///< pool memory for static allocation; NULL for dynamic allocation
+  uint32_t                *bitmap;      ///< pool bitmap for static allocation; NULL for dynamic allocation
+#endif
 } osMailQDef_t;
 
 /// Event structure contains detailed information about an event.
@@ -707,10 +757,25 @@ osStatus osSemaphoreDelete (osSemaphoreId semaphore_id);
 #define osPoolDef(name, no, type)   \
 extern const osPoolDef_t os_pool_def_##name
 #else                            // define the object
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+#define osPoolDef(name, no, type)   \
+const osPoolDef_t os_pool_def_##name = \
+{ (no), sizeof(type), NULL, NULL, NULL }
+
+/// \brief Define a Memory Pool whose blocks, bitmap and control block are
+///        all allocated statically, so that \ref osPoolCreate makes no heap allocation.
+#define osPoolStaticDef(name, no, type)   \
+static uint32_t os_pool_mem_##name[(no) * osPoolItemWords(type)]; \
+static uint32_t os_pool_bitmap_##name[osPoolBitmapWords(no)]; \
+static osStaticPoolDef_t os_pool_cb_##name; \
+const osPoolDef_t os_pool_def_##name = \
+{ (no), sizeof(type), os_pool_mem_##name, os_pool_bitmap_##name, &os_pool_cb_##name }
+#else //configSUPPORT_STATIC_ALLOCATION == 1
 #define osPoolDef(name, no, type)   \
 const osPoolDef_t os_pool_def_##name = \
 { (no), sizeof(type), NULL }
 #endif
+#endif
 
 /// \brief Access a Memory Pool definition.
 /// \param         name          name of the memory pool
@@ -744,6 +809,13 @@ void *osPoolCAlloc (osPoolId pool_id);
 /// \note MUST REMAIN UNCHANGED: \b osPoolFree shall be consistent in every CMSIS-RTOS.
 osStatus osPoolFree (osPoolId pool_id, void *block);
 
+#if (configOS1_POOL_PREZERO == 1)
+/// Zero one freed memory pool block, so that \ref osPoolCAlloc and \ref osMailCAlloc
+/// can hand it out without clearing it (extension).
+/// \note Call from the FreeRTOS idle hook, vApplicationIdleHook().
+void osPoolZeroIdle (void);
+#endif
+
 #endif   // Memory Pool Management available
 
 
@@ -824,11 +896,30 @@ osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec);
 extern struct os_mailQ_cb *os_mailQ_cb_##name \
 extern osMailQDef_t os_mailQ_def_##name
 #else                            // define the object
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+#define osMailQDef(name, queue_sz, type) \
+struct os_mailQ_cb *os_mailQ_cb_##name; \
+const osMailQDef_t os_mailQ_def_##name =  \
+{ (queue_sz), sizeof (type), (&os_mailQ_cb_##name), NULL, NULL, NULL, NULL }
+
+/// \brief Define a Mail Queue whose control blocks, message buffer and pool are
+///        all allocated statically, so that \ref osMailCreate makes no heap allocation.
+#define osMailQStaticDef(name, queue_sz, type) \
+struct os_mailQ_cb *os_mailQ_cb_##name; \
+static osStaticMailQDef_t os_mailQ_storage_##name; \
+static void *os_mailQ_buffer_##name[(queue_sz)]; \
+static uint32_t os_mailQ_pool_##name[(queue_sz) * osPoolItemWords(type)]; \
+static uint32_t os_mailQ_bitmap_##name[osPoolBitmapWords(queue_sz)]; \
+const osMailQDef_t os_mailQ_def_##name =  \
+{ (queue_sz), sizeof (type), (&os_mailQ_cb_##name), &os_mailQ_storage_##name, \
+  (uint8_t *)os_mailQ_buffer_##name, os_mailQ_pool_##name, os_mailQ_bitmap_##name }
+#else //configSUPPORT_STATIC_ALLOCATION == 1
 #define osMailQDef(name, queue_sz, type) \
 struct os_mailQ_cb *os_mailQ_cb_##name; \
 const osMailQDef_t os_mailQ_def_##name =  \
 { (queue_sz), sizeof (type), (&os_mailQ_cb_##name) }
 #endif
+#endif
 
 /// \brief Access a Mail Queue Definition.
 /// \param         name          name of the queue
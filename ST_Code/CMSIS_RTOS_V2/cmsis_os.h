@@ -140,9 +140,9 @@
 #define osFeature_Semaphore   65535U    ///< maximum count for \ref osSemaphoreCreate function
 #define osFeature_Wait        0         ///< osWait function: 1=available, 0=not available
 #define osFeature_SysTick     1         ///< osKernelSysTick functions: 1=available, 0=not available
-#define osFeature_Pool        0         ///< Memory Pools:    1=available, 0=not available
+#define osFeature_Pool        1         ///< Memory Pools:    1=available, 0=not available
 #define osFeature_MessageQ    1         ///< Message Queues:  1=available, 0=not available
-#define osFeature_MailQ       0         ///< Mail Queues:     1=available, 0=not available
+#define osFeature_MailQ       1         ///< Mail Queues:     1=available, 0=not available
  
 #if   defined(__CC_ARM)
 #define os_InRegs __value_in_regs
@@ -153,6 +153,7 @@
 #endif
  
 #include "cmsis_os2.h"
+#include "freertos_mailq.h"
  
 #ifdef  __cplusplus
 extern "C"
@@ -355,9 +356,7 @@ typedef struct os_mailQ_def {
 typedef struct os_mailQ_def {
   uint32_t                  queue_sz;   ///< number of elements in the queue
   uint32_t                   item_sz;   ///< size of an item
-  void                         *mail;   ///< pointer to mail
-  osMemoryPoolAttr_t         mp_attr;   ///< memory pool attributes
-  osMessageQueueAttr_t       mq_attr;   ///< message queue attributes
+  osMailQueueAttr_t             attr;   ///< mail queue attributes
 } osMailQDef_t;
 #endif
  
@@ -697,8 +696,12 @@ osStatus osSemaphoreDelete (osSemaphoreId semaphore_id);
 extern const osPoolDef_t os_pool_def_##name
 #else                            // define the object
 #define osPoolDef(name, no, type) \
+static StaticMemPool_t os_mp_cb_##name; \
+static uint32_t os_mp_data_##name[MEMPOOL_ARR_SIZE((no), sizeof(type)) / sizeof(uint32_t)]; \
 const osPoolDef_t os_pool_def_##name = \
-{ (no), sizeof(type), {NULL} }
+{ (no), sizeof(type), \
+  { NULL, 0U, (&os_mp_cb_##name), sizeof(StaticMemPool_t), \
+              (&os_mp_data_##name), sizeof(os_mp_data_##name) } }
 #endif
  
 /// \brief Access a Memory Pool definition.
@@ -706,6 +709,11 @@ const osPoolDef_t os_pool_def_##name = \
 #define osPool(name) \
 &os_pool_def_##name
  
+/// \brief Define a Memory Pool with static storage (extension).
+/// \note Same as \ref osPoolDef: its storage is already static.
+#define osPoolStaticDef(name, no, type) \
+osPoolDef(name, no, type)
+ 
 /// Create and Initialize a Memory Pool object.
 /// \param[in]     pool_def      memory pool definition referenced with \ref osPool.
 /// \return memory pool ID for reference by other functions or NULL in case of error.
@@ -727,6 +735,11 @@ void *osPoolCAlloc (osPoolId pool_id);
 /// \return status code that indicates the execution status of the function.
 osStatus osPoolFree (osPoolId pool_id, void *block);
  
+/// Zero one freed memory block ahead of \ref osPoolCAlloc (extension).
+/// \note The default idle hook already zeroes blocks; call this only from an
+/// application's own vApplicationIdleHook. Does nothing unless configOS2_MPOOL_PREZERO is 1.
+void osPoolZeroIdle (void);
+ 
 #endif  // Memory Pool available
  
  
@@ -743,11 +756,11 @@ osStatus osPoolFree (osPoolId pool_id, void *block);
 extern const osMessageQDef_t os_messageQ_def_##name
 #else                            // define the object
 #define osMessageQDef(name, queue_sz, type) \
-static StaticQueue_t os_mq_cb_##name; \
-static uint32_t os_mq_data_##name[(queue_sz) * sizeof(type)]; \
+static StaticMessageQueue_t os_mq_cb_##name; \
+static uint32_t os_mq_data_##name[MQUEUE_ARR_SIZE((queue_sz), sizeof(uint32_t)) / sizeof(uint32_t)]; \
 const osMessageQDef_t os_messageQ_def_##name = \
 { (queue_sz), \
-  { NULL, 0U, (&os_mq_cb_##name), sizeof(StaticQueue_t), \
+  { NULL, 0U, (&os_mq_cb_##name), sizeof(StaticMessageQueue_t), \
               (&os_mq_data_##name), sizeof(os_mq_data_##name) } }
 #endif
  
@@ -791,8 +804,14 @@ os_InRegs osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec);
 extern const osMailQDef_t os_mailQ_def_##name
 #else                            // define the object
 #define osMailQDef(name, queue_sz, type) \
+static StaticMailQueue_t os_mailQ_cb_##name; \
+static uint32_t os_mailQ_mp_##name[MAILQ_MP_SIZE((queue_sz), sizeof(type)) / sizeof(uint32_t)]; \
+static uint32_t os_mailQ_mq_##name[MAILQ_MQ_SIZE(queue_sz) / sizeof(uint32_t)]; \
 const osMailQDef_t os_mailQ_def_##name = \
-{ (queue_sz), sizeof(type), NULL }
+{ (queue_sz), sizeof(type), \
+  { NULL, 0U, (&os_mailQ_cb_##name), sizeof(StaticMailQueue_t), \
+              (&os_mailQ_mp_##name), sizeof(os_mailQ_mp_##name), \
+              (&os_mailQ_mq_##name), sizeof(os_mailQ_mq_##name) } }
 #endif
  
 /// \brief Access a Mail Queue Definition.
@@ -800,6 +819,11 @@ const osMailQDef_t os_mailQ_def_##name = \
 #define osMailQ(name) \
 &os_mailQ_def_##name
  
+/// \brief Define a Mail Queue with static storage (extension).
+/// \note Same as \ref osMailQDef: its storage is already static.
+#define osMailQStaticDef(name, queue_sz, type) \
+osMailQDef(name, queue_sz, type)
+ 
 /// Create and Initialize a Mail Queue object.
 /// \param[in]     queue_def     mail queue definition referenced with \ref osMailQ.
 /// \param[in]     thread_id     thread ID (obtained by \ref osThreadCreate or \ref osThreadGetId) or NULL.
@@ -0,0 +1,337 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    cmsis_os1.c
+ *      Purpose: CMSIS RTOS v1 compatibility layer over the RTOS2 wrapper
+ *
+ *---------------------------------------------------------------------------*/
+
+#include "cmsis_os.h"                   // ::CMSIS:RTOS v1 over RTOS2
+
+/* Every v1 call maps onto the RTOS2 wrapper, so a mixed application links
+   one implementation of each object: v1 pools get the lock-free RTOS2
+   pool, v1 mail the zero-copy mail queue, and v1 signals the RTOS2 thread
+   flags. Objects are created from the static storage that the definition
+   macros in cmsis_os.h set aside, so creating them takes no heap. */
+
+#if (osCMSIS >= 0x20000U)
+
+/* Signal flags available to v1 callers */
+#define SIGNAL_MASK               ((1UL << osFeature_Signals) - 1UL)
+
+/* Map a failed RTOS2 flags call onto a v1 event status */
+static osStatus FlagsErrorToStatus (uint32_t flags) {
+  osStatus stat;
+
+  switch (flags) {
+    case osFlagsErrorResource:
+      /* No flags set and no time to wait */
+      stat = osOK;
+      break;
+
+    case osFlagsErrorTimeout:
+      stat = osEventTimeout;
+      break;
+
+    case osFlagsErrorParameter:
+      stat = osErrorValue;
+      break;
+
+    case osFlagsErrorISR:
+      stat = osErrorISR;
+      break;
+
+    default:
+      stat = osErrorOS;
+      break;
+  }
+
+  return (stat);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osThreadId osThreadCreate (const osThreadDef_t *thread_def, void *argument) {
+  osThreadId thread_id;
+
+  if (thread_def == NULL) {
+    thread_id = NULL;
+  }
+  else {
+    thread_id = osThreadNew ((osThreadFunc_t)thread_def->pthread, argument, &thread_def->attr);
+  }
+
+  return (thread_id);
+}
+
+/*---------------------------------------------------------------------------*/
+
+int32_t osSignalSet (osThreadId thread_id, int32_t signals) {
+  uint32_t flags;
+
+  flags = osThreadFlagsSet (thread_id, (uint32_t)signals);
+
+  if ((flags & osFlagsError) != 0U) {
+    flags = 0x80000000U;
+  }
+  else {
+    /* Report the flags as they were before this call */
+    flags &= ~(uint32_t)signals;
+  }
+
+  return ((int32_t)flags);
+}
+
+int32_t osSignalClear (osThreadId thread_id, int32_t signals) {
+  uint32_t flags;
+
+  /* RTOS2 clears flags of the running thread only */
+  if (thread_id != osThreadGetId()) {
+    flags = 0x80000000U;
+  }
+  else {
+    flags = osThreadFlagsClear ((uint32_t)signals);
+
+    if ((flags & osFlagsError) != 0U) {
+      flags = 0x80000000U;
+    }
+  }
+
+  return ((int32_t)flags);
+}
+
+osEvent osSignalWait (int32_t signals, uint32_t millisec) {
+  osEvent  event;
+  uint32_t flags;
+
+  if (signals != 0) {
+    flags = osThreadFlagsWait ((uint32_t)signals, osFlagsWaitAll, millisec);
+  }
+  else {
+    flags = osThreadFlagsWait (SIGNAL_MASK, osFlagsWaitAny, millisec);
+  }
+
+  if ((flags & osFlagsError) != 0U) {
+    event.status = FlagsErrorToStatus (flags);
+  }
+  else {
+    event.status = osEventSignal;
+    event.value.signals = (int32_t)flags;
+  }
+
+  return (event);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osTimerId osTimerCreate (const osTimerDef_t *timer_def, os_timer_type type, void *argument) {
+  osTimerId timer_id;
+
+  if (timer_def == NULL) {
+    timer_id = NULL;
+  }
+  else {
+    timer_id = osTimerNew ((osTimerFunc_t)timer_def->ptimer, type, argument, &timer_def->attr);
+  }
+
+  return (timer_id);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMutexId osMutexCreate (const osMutexDef_t *mutex_def) {
+  return (osMutexNew (mutex_def));
+}
+
+/*---------------------------------------------------------------------------*/
+
+osSemaphoreId osSemaphoreCreate (const osSemaphoreDef_t *semaphore_def, int32_t count) {
+  osSemaphoreId semaphore_id;
+
+  if (count <= 0) {
+    semaphore_id = NULL;
+  }
+  else {
+    semaphore_id = osSemaphoreNew ((uint32_t)count, (uint32_t)count, semaphore_def);
+  }
+
+  return (semaphore_id);
+}
+
+int32_t osSemaphoreWait (osSemaphoreId semaphore_id, uint32_t millisec) {
+  int32_t tokens;
+
+  switch (osSemaphoreAcquire (semaphore_id, millisec)) {
+    case osOK:
+      /* v1 counts the token just taken as still available */
+      tokens = (int32_t)osSemaphoreGetCount (semaphore_id) + 1;
+      break;
+
+    case osErrorResource:
+    case osErrorTimeout:
+      tokens = 0;
+      break;
+
+    default:
+      tokens = -1;
+      break;
+  }
+
+  return (tokens);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osPoolId osPoolCreate (const osPoolDef_t *pool_def) {
+  osPoolId pool_id;
+
+  if (pool_def == NULL) {
+    pool_id = NULL;
+  }
+  else {
+    pool_id = osMemoryPoolNew (pool_def->pool_sz, pool_def->item_sz, &pool_def->attr);
+  }
+
+  return (pool_id);
+}
+
+void *osPoolAlloc (osPoolId pool_id) {
+  return (osMemoryPoolAlloc (pool_id, 0U));
+}
+
+void *osPoolCAlloc (osPoolId pool_id) {
+  return (osMemoryPoolCAlloc (pool_id, 0U));
+}
+
+osStatus osPoolFree (osPoolId pool_id, void *block) {
+  return (osMemoryPoolFree (pool_id, block));
+}
+
+void osPoolZeroIdle (void) {
+  osMemoryPoolZeroIdle();
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMessageQId osMessageCreate (const osMessageQDef_t *queue_def, osThreadId thread_id) {
+  osMessageQId queue_id;
+
+  (void)thread_id;
+
+  if (queue_def == NULL) {
+    queue_id = NULL;
+  }
+  else {
+    /* v1 messages are a single 32-bit value */
+    queue_id = osMessageQueueNew (queue_def->queue_sz, sizeof(uint32_t), &queue_def->attr);
+  }
+
+  return (queue_id);
+}
+
+osStatus osMessagePut (osMessageQId queue_id, uint32_t info, uint32_t millisec) {
+  return (osMessageQueuePut (queue_id, &info, 0U, millisec));
+}
+
+osEvent osMessageGet (osMessageQId queue_id, uint32_t millisec) {
+  osEvent  event;
+  uint32_t message;
+
+  event.def.message_id = queue_id;
+
+  switch (osMessageQueueGet (queue_id, &message, NULL, millisec)) {
+    case osOK:
+      event.status = osEventMessage;
+      event.value.v = message;
+      break;
+
+    case osErrorResource:
+      event.status = osOK;
+      break;
+
+    case osErrorTimeout:
+      event.status = osEventTimeout;
+      break;
+
+    default:
+      event.status = osErrorParameter;
+      break;
+  }
+
+  return (event);
+}
+
+/*---------------------------------------------------------------------------*/
+
+osMailQId osMailCreate (const osMailQDef_t *queue_def, osThreadId thread_id) {
+  osMailQId queue_id;
+
+  (void)thread_id;
+
+  if (queue_def == NULL) {
+    queue_id = NULL;
+  }
+  else {
+    queue_id = osMailQueueNew (queue_def->queue_sz, queue_def->item_sz, &queue_def->attr);
+  }
+
+  return (queue_id);
+}
+
+void *osMailAlloc (osMailQId queue_id, uint32_t millisec) {
+  return (osMailQueueAlloc (queue_id, millisec));
+}
+
+void *osMailCAlloc (osMailQId queue_id, uint32_t millisec) {
+  return (osMailQueueCAlloc (queue_id, millisec));
+}
+
+osStatus osMailPut (osMailQId queue_id, const void *mail) {
+  return (osMailQueuePut (queue_id, (void *)mail, 0U));
+}
+
+osEvent osMailGet (osMailQId queue_id, uint32_t millisec) {
+  osEvent event;
+
+  event.def.mail_id = queue_id;
+
+  switch (osMailQueueGet (queue_id, &event.value.p, NULL, millisec)) {
+    case osOK:
+      event.status = osEventMail;
+      break;
+
+    case osErrorResource:
+      event.status = osOK;
+      break;
+
+    case osErrorTimeout:
+      event.status = osEventTimeout;
+      break;
+
+    default:
+      event.status = osErrorParameter;
+      break;
+  }
+
+  return (event);
+}
+
+osStatus osMailFree (osMailQId queue_id, void *mail) {
+  return (osMailQueueFree (queue_id, mail));
+}
+
+#endif /* osCMSIS >= 0x20000U */
@@ -31,6 +31,8 @@
 #include "semphr.h"                     // ARM.FreeRTOS::RTOS:Core
 
 #include "freertos_mpool.h"             // osMemoryPool definitions
+#include "freertos_mqueue.h"            // osMessageQueue definitions
+#include "freertos_mailq.h"             // osMailQueue definitions
 #include "freertos_os2.h"               // Configuration check and setup
 
 /*---------------------------------------------------------------------------*/
@@ -102,6 +104,303 @@ typedef struct {
 /* Kernel initialization state */
 static osKernelState_t KernelState = osKernelInactive;
 
+#if (configOS2_EVENTFLAGS_DIRECT == 1)
+/* Thread blocked in osEventFlagsWait, linked into the event flags object */
+typedef struct EventFlagsWaiter_s {
+  struct EventFlagsWaiter_s *next;    /* Next waiting thread          */
+  TaskHandle_t               task;    /* Waiting thread, NULL if woken */
+  uint32_t                   flags;   /* Flags to wait for            */
+  uint32_t                   options; /* Wait options                 */
+  uint32_t                   rflags;  /* Flags on wake-up, or error   */
+} EventFlagsWaiter_t;
+
+/* Event flags control block */
+typedef struct {
+  volatile uint32_t          flags;   /* Event flags                  */
+  EventFlagsWaiter_t        *waiters; /* Waiting threads, in order    */
+  uint32_t                   status;  /* Bit 0: control block allocated by osEventFlagsNew */
+} EventFlags_t;
+
+typedef EventFlags_t       SlabEventFlags_t;
+#else
+typedef StaticEventGroup_t SlabEventFlags_t;
+#endif
+
+/*
+  Control block slabs
+
+  Objects created without cb_mem take their control block from a slab: a
+  static array of fixed size slots, one array per kind of control block.
+  Allocation and release are O(1) and never touch the FreeRTOS heap, so
+  creating and deleting objects cannot fragment it. When a slab is full,
+  control blocks come from the heap as before. Slab sizes are set by the
+  configOS2_SLAB_* definitions (see freertos_os2.h).
+*/
+typedef enum {
+  SLAB_THREAD = 0,
+  SLAB_TIMER,
+  SLAB_EVENTFLAGS,
+  SLAB_SEMAPHORE,
+  SLAB_MQUEUE,
+  SLAB_MPOOL,
+  SLAB_MAILQ,
+  SLAB_COUNT
+} SlabClass_t;
+
+/* Thread slot: the stack is allocated on the heap and released with the TCB */
+typedef struct {
+  StaticTask_t     tcb;
+  StackType_t     *stack;
+} SlabThread_t;
+
+/* Timer slot: timer and callback information in one allocation */
+typedef struct {
+  StaticTimer_t    timer;
+  TimerCallback_t  callb;
+} SlabTimer_t;
+
+/* Slab control block */
+typedef struct {
+  uint8_t         *mem;         /* Slot array               */
+  uint32_t         sz;          /* Size of a single slot    */
+  uint32_t         cnt;         /* Number of slots          */
+  uint32_t         n;           /* Slot allocation index    */
+  void            *head;        /* List of released slots   */
+} Slab_t;
+
+/* Slot arrays always have at least one element; a count of 0 disables a slab */
+#define SLAB_ARR_LEN(cnt)         (((cnt) > 0U) ? (cnt) : 1U)
+
+static SlabThread_t       SlabThreadMem    [SLAB_ARR_LEN(configOS2_SLAB_THREAD_COUNT)];
+static SlabTimer_t        SlabTimerMem     [SLAB_ARR_LEN(configOS2_SLAB_TIMER_COUNT)];
+static SlabEventFlags_t   SlabEventFlagsMem[SLAB_ARR_LEN(configOS2_SLAB_EVENTFLAGS_COUNT)];
+static StaticSemaphore_t  SlabSemaphoreMem [SLAB_ARR_LEN(configOS2_SLAB_SEMAPHORE_COUNT)];
+static MessageQueue_t     SlabMQueueMem    [SLAB_ARR_LEN(configOS2_SLAB_MQUEUE_COUNT)];
+static MemPool_t          SlabMPoolMem     [SLAB_ARR_LEN(configOS2_SLAB_MPOOL_COUNT)];
+static MailQueue_t        SlabMailQMem     [SLAB_ARR_LEN(configOS2_SLAB_MAILQ_COUNT)];
+
+static Slab_t Slab[SLAB_COUNT] = {
+  { (uint8_t *)SlabThreadMem,     sizeof(SlabThread_t),       configOS2_SLAB_THREAD_COUNT,     0U, NULL },
+  { (uint8_t *)SlabTimerMem,      sizeof(SlabTimer_t),        configOS2_SLAB_TIMER_COUNT,      0U, NULL },
+  { (uint8_t *)SlabEventFlagsMem, sizeof(SlabEventFlags_t),   configOS2_SLAB_EVENTFLAGS_COUNT, 0U, NULL },
+  { (uint8_t *)SlabSemaphoreMem,  sizeof(StaticSemaphore_t),  configOS2_SLAB_SEMAPHORE_COUNT,  0U, NULL },
+  { (uint8_t *)SlabMQueueMem,     sizeof(MessageQueue_t),     configOS2_SLAB_MQUEUE_COUNT,     0U, NULL },
+  { (uint8_t *)SlabMPoolMem,      sizeof(MemPool_t),          configOS2_SLAB_MPOOL_COUNT,      0U, NULL },
+  { (uint8_t *)SlabMailQMem,      sizeof(MailQueue_t),        configOS2_SLAB_MAILQ_COUNT,      0U, NULL }
+};
+
+/*
+  Take a slot from a slab. Return NULL if the slab is full.
+*/
+static void *SlabAlloc (SlabClass_t cls) {
+  Slab_t *slab = &Slab[cls];
+  void *p;
+
+  taskENTER_CRITICAL();
+
+  p = slab->head;
+
+  if (p != NULL) {
+    /* Reuse a released slot */
+    slab->head = *(void **)p;
+  }
+  else if (slab->n < slab->cnt) {
+    /* Use the next slot never allocated */
+    p = slab->mem + (slab->sz * slab->n);
+    slab->n += 1U;
+  }
+
+  taskEXIT_CRITICAL();
+
+  return (p);
+}
+
+/*
+  Check whether a slab holds the given address.
+*/
+static uint32_t SlabOwns (SlabClass_t cls, const void *p) {
+  const Slab_t *slab = &Slab[cls];
+
+  return (((const uint8_t *)p >= slab->mem) && ((const uint8_t *)p < (slab->mem + (slab->sz * slab->cnt))));
+}
+
+/*
+  Return a slot to its slab. Return 0 if the slab does not hold it.
+*/
+static uint32_t SlabFree (SlabClass_t cls, void *p) {
+  Slab_t *slab = &Slab[cls];
+  uint32_t owned;
+
+  owned = SlabOwns (cls, p);
+
+  if (owned != 0U) {
+    taskENTER_CRITICAL();
+
+    *(void **)p = slab->head;
+    slab->head  = p;
+
+    taskEXIT_CRITICAL();
+  }
+
+  return (owned);
+}
+
+/*
+  Allocate a control block: from its slab, or from the heap if the slab is full.
+*/
+static void *CBAlloc (SlabClass_t cls, size_t size) {
+  void *p;
+
+  p = SlabAlloc (cls);
+
+  if (p == NULL) {
+    p = pvPortMalloc (size);
+  }
+
+  return (p);
+}
+
+/*
+  Release a control block allocated with CBAlloc.
+*/
+static void CBFree (SlabClass_t cls, void *p) {
+  if (SlabFree (cls, p) == 0U) {
+    vPortFree (p);
+  }
+}
+
+/*
+  Release a thread's slab slot and stack once FreeRTOS has finished with
+  them. Called through portCLEAN_UP_TCB for every deleted task, from the
+  deleting task or from the idle task for a thread that exits itself.
+*/
+void vOS2CleanUpTCB (void *tcb) {
+  SlabThread_t *slot = (SlabThread_t *)tcb;
+
+  if (SlabOwns (SLAB_THREAD, slot) != 0U) {
+    vPortFree (slot->stack);
+    (void)SlabFree (SLAB_THREAD, slot);
+  }
+}
+
+#if (configUSE_OS2_TIMER == 1)
+#if (configOS2_SLAB_TIMER_COUNT > 0)
+/* Timer slots whose release could not yet be queued, one bit per slot */
+#define SLAB_TIMER_DEFERRED_WORDS ((SLAB_ARR_LEN(configOS2_SLAB_TIMER_COUNT) + 31U) / 32U)
+
+static uint32_t SlabTimerDeferred[SLAB_TIMER_DEFERRED_WORDS];
+
+/*
+  Release a timer's slab slot. Run by the timer service task after it has
+  processed the delete command for the timer.
+*/
+static void SlabTimerRelease (void *slot, uint32_t unused) {
+  (void)unused;
+  (void)SlabFree (SLAB_TIMER, slot);
+}
+#endif
+
+/*
+  Queue the release of deleted timers' slab slots behind their delete
+  commands. The timer command queue is never waited on, so this is safe
+  from a timer callback: a slot whose release does not fit stays marked
+  and is retried by the next osTimerNew or osTimerDelete. Pass NULL to
+  only retry slots already marked.
+*/
+static void SlabTimerReclaim (SlabTimer_t *slot) {
+#if (configOS2_SLAB_TIMER_COUNT > 0)
+  uint32_t i, n, bits;
+
+  taskENTER_CRITICAL();
+  if (slot != NULL) {
+    n = (uint32_t)(slot - SlabTimerMem);
+    SlabTimerDeferred[n >> 5] |= (1UL << (n & 31U));
+  }
+  taskEXIT_CRITICAL();
+
+  for (i = 0U; i < SLAB_TIMER_DEFERRED_WORDS; i++) {
+    for (;;) {
+      /* Claim one marked slot, so no other thread queues its release too */
+      taskENTER_CRITICAL();
+      bits = SlabTimerDeferred[i];
+      if (bits != 0U) {
+        n = 31U - __CLZ (bits);
+        SlabTimerDeferred[i] = bits & ~(1UL << n);
+      }
+      taskEXIT_CRITICAL();
+
+      if (bits == 0U) {
+        break;
+      }
+
+      if (xTimerPendFunctionCall (SlabTimerRelease, &SlabTimerMem[(i << 5) | n], 0U, 0U) != pdPASS) {
+        /* Queue still full: put the mark back and retry later */
+        taskENTER_CRITICAL();
+        SlabTimerDeferred[i] |= (1UL << n);
+        taskEXIT_CRITICAL();
+        return;
+      }
+    }
+  }
+#else
+  /* No timer slab: no slot is ever marked */
+  (void)slot;
+#endif
+}
+#endif
+
+/*
+  Thread registry
+
+  Every task, including the idle and timer service tasks created by the
+  kernel, is recorded in a fixed table by the FreeRTOS traceTASK_CREATE and
+  traceTASK_DELETE hooks. Both hooks are called from within a kernel critical
+  section. Slots are never compacted, so a slot index is a stable enumeration
+  cursor for osThreadEnumerateNext while threads come and go: a thread that
+  exists for the whole enumeration is listed exactly once.
+*/
+#define THREAD_REGISTRY_CHUNK     8U    /* Slots scanned per critical section */
+
+static struct {
+  TaskHandle_t     task[(configOS2_THREAD_REGISTRY_SIZE > 0U) ? configOS2_THREAD_REGISTRY_SIZE : 1U];
+  uint32_t         tracked;             /* Number of tasks in the table     */
+  uint32_t         untracked;           /* Number of tasks that did not fit */
+} ThreadRegistry;
+
+void vOS2TraceTaskCreate (void *tcb) {
+  uint32_t i;
+
+  for (i = 0U; i < configOS2_THREAD_REGISTRY_SIZE; i++) {
+    if (ThreadRegistry.task[i] == NULL) {
+      break;
+    }
+  }
+
+  if (i < configOS2_THREAD_REGISTRY_SIZE) {
+    ThreadRegistry.task[i] = (TaskHandle_t)tcb;
+    ThreadRegistry.tracked += 1U;
+  } else {
+    ThreadRegistry.untracked += 1U;
+  }
+}
+
+void vOS2TraceTaskDelete (void *tcb) {
+  uint32_t i;
+
+  for (i = 0U; i < configOS2_THREAD_REGISTRY_SIZE; i++) {
+    if (ThreadRegistry.task[i] == (TaskHandle_t)tcb) {
+      break;
+    }
+  }
+
+  if (i < configOS2_THREAD_REGISTRY_SIZE) {
+    ThreadRegistry.task[i] = NULL;
+    ThreadRegistry.tracked -= 1U;
+  } else if (ThreadRegistry.untracked > 0U) {
+    ThreadRegistry.untracked -= 1U;
+  }
+}
+
 /*
   Heap region definition used by heap_5 variant
 
@@ -187,6 +486,44 @@ __STATIC_INLINE void SVC_Setup (void) {
 #define uxSemaphoreGetCountFromISR( xSemaphore ) uxQueueMessagesWaitingFromISR( ( QueueHandle_t ) ( xSemaphore ) )
 #endif
 
+/*
+  64-bit system timer
+
+  On cores with a DWT cycle counter the system timer is CYCCNT, extended to
+  64 bits by counting its wraps. The wrap count is brought up to date every
+  tick by vOS2SysTimerUpdate, which runs at or below the kernel interrupt
+  priority and so never interrupts itself. Readers may run in any context
+  and never mask interrupts: the update fills in the copy of the high word
+  and last count that readers are not using, then switches them over to it
+  by incrementing the sequence number, so a reader never waits on an update
+  it has interrupted. A read is correct while the last update is less than
+  2^32 cycles old, which the tick guarantees once the kernel is running.
+*/
+#if ((__ARM_ARCH_7M__      == 1U) || \
+     (__ARM_ARCH_7EM__     == 1U) || \
+     (__ARM_ARCH_8M_MAIN__ == 1U))
+#define SYSTIMER_DWT              1
+#else
+#define SYSTIMER_DWT              0
+#endif
+
+static struct {
+  volatile uint32_t seq;                /* Update count; bit 0 selects the copy */
+  volatile uint32_t high[2];            /* High word of the count               */
+  volatile uint32_t last[2];            /* Low word when the high word was set  */
+} SysTimer;
+
+/* Count to ns conversion factors, read and written whole with IRQs masked */
+typedef struct {
+  uint32_t         freq;                /* Timer frequency the factors are for  */
+  uint32_t         mult;                /* ns per count << shift                */
+  uint32_t         shift;               /* Fraction bits of mult                */
+  uint64_t         wrap;                /* ns per 2^32 counts                   */
+  uint32_t         wrap_frac;           /* Fraction of wrap << 32               */
+} SysTimerScale_t;
+
+static SysTimerScale_t SysTimerScale;
+
 /* Get OS Tick count value */
 static uint32_t OS_Tick_GetCount (void);
 /* Get OS Tick overflow status */
@@ -209,6 +546,11 @@ osStatus_t osKernelInitialize (void) {
       #if defined(USE_FreeRTOS_HEAP_5) && (HEAP_5_REGION_SETUP == 1)
         vPortDefineHeapRegions (configHEAP_5_REGIONS);
       #endif
+      #if (SYSTIMER_DWT == 1)
+        /* Start the cycle counter used as system timer */
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+      #endif
       KernelState = osKernelReady;
       stat = osOK;
     } else {
@@ -413,6 +755,9 @@ static uint32_t OS_Tick_GetInterval (void) {
 }
 
 uint32_t osKernelGetSysTimerCount (void) {
+#if (SYSTIMER_DWT == 1)
+  return (DWT->CYCCNT);
+#else
   uint32_t irqmask = IS_IRQ_MASKED();
   TickType_t ticks;
   uint32_t val;
@@ -433,12 +778,278 @@ uint32_t osKernelGetSysTimerCount (void) {
   }
 
   return (val);
+#endif
 }
 
 uint32_t osKernelGetSysTimerFreq (void) {
   return (configCPU_CLOCK_HZ);
 }
 
+/*
+  Bring the 64-bit system timer's high word up to date. Called every tick
+  from xTaskIncrementTick (traceTASK_INCREMENT_TICK).
+*/
+void vOS2SysTimerUpdate (void) {
+#if (SYSTIMER_DWT == 1)
+  uint32_t seq, idx, low, high;
+
+  seq  = SysTimer.seq;
+  idx  = seq & 1U;
+  high = SysTimer.high[idx];
+  low  = DWT->CYCCNT;
+
+  if (low < SysTimer.last[idx]) {
+    /* Counter wrapped since the last update */
+    high += 1U;
+  }
+
+  /* Fill in the copy readers are not using, then switch them over to it */
+  SysTimer.high[idx ^ 1U] = high;
+  SysTimer.last[idx ^ 1U] = low;
+  __DMB();
+  SysTimer.seq = seq + 1U;
+#endif
+}
+
+uint64_t osKernelGetSysTimerCount64 (void) {
+#if (SYSTIMER_DWT == 1)
+  uint32_t seq, idx, low, high, last;
+
+  do {
+    seq  = SysTimer.seq;
+    __DMB();
+    idx  = seq & 1U;
+    high = SysTimer.high[idx];
+    last = SysTimer.last[idx];
+    low  = DWT->CYCCNT;
+    __DMB();
+  }
+  /* Retry if the copy read may have been overwritten meanwhile */
+  while (SysTimer.seq != seq);
+
+  if (low < last) {
+    /* Counter wrapped since the last update */
+    high += 1U;
+  }
+
+  return (((uint64_t)high << 32) | low);
+#else
+  uint32_t irqmask = IS_IRQ_MASKED();
+  TickType_t ticks;
+  uint64_t val;
+
+  /* No cycle counter: count SysTick periods, which wraps with the tick count */
+  __disable_irq();
+
+  ticks = xTaskGetTickCount();
+  val   = OS_Tick_GetCount();
+
+  if (OS_Tick_GetOverflow() != 0U) {
+    val = OS_Tick_GetCount();
+    ticks++;
+  }
+  val += (uint64_t)ticks * OS_Tick_GetInterval();
+
+  if (irqmask == 0U) {
+    __enable_irq();
+  }
+
+  return (val);
+#endif
+}
+
+uint64_t osKernelSysTimerToNs (uint64_t count) {
+  uint32_t freq = configCPU_CLOCK_HZ;
+  uint32_t irqmask = IS_IRQ_MASKED();
+  SysTimerScale_t scale;
+  uint32_t shift;
+
+  /* Take a consistent copy: an interrupt may publish new factors */
+  __disable_irq();
+  scale = SysTimerScale;
+  if (irqmask == 0U) {
+    __enable_irq();
+  }
+
+  if (scale.freq != freq) {
+    /* First use, or the core clock changed: find the most precise 32-bit
+       factor once instead of dividing on every call */
+    for (shift = 32U; ((1000000000ULL << shift) / freq) > 0xFFFFFFFFU; shift--);
+
+    scale.mult      = (uint32_t)((1000000000ULL << shift) / freq);
+    scale.shift     = shift;
+    scale.wrap      = (1000000000ULL << 32) / freq;
+    scale.wrap_frac = (uint32_t)((((1000000000ULL << 32) % freq) << 32) / freq);
+    scale.freq      = freq;
+
+    /* Publish all the factors at once */
+    __disable_irq();
+    SysTimerScale = scale;
+    if (irqmask == 0U) {
+      __enable_irq();
+    }
+  }
+
+  return (((count >> 32) * scale.wrap) +
+          (((count >> 32) * scale.wrap_frac) >> 32) +
+          (((count & 0xFFFFFFFFU) * scale.mult) >> scale.shift));
+}
+
+uint64_t osKernelNsToSysTimer (uint64_t ns) {
+  uint32_t freq = configCPU_CLOCK_HZ;
+
+  return (((ns / 1000000000U) * freq) + (((ns % 1000000000U) * freq) / 1000000000U));
+}
+
+/*
+  Tickless idle
+
+  When no thread is due to run for configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+  ticks or more, the idle task calls vOS2SuppressTicksAndSleep
+  (portSUPPRESS_TICKS_AND_SLEEP, with configUSE_TICKLESS_IDLE set to 2).
+  SysTick is reloaded to interrupt when the next thread is due, or after as
+  many ticks as its 24-bit counter can hold, and the core sleeps until then
+  or until another interrupt. On waking, the tick count is stepped over the
+  whole ticks slept and SysTick resumes its normal period.
+
+  Only Sleep mode is used: under Microvisor the power and clock controllers
+  belong to the secure side, and the non-secure SysTick keeps counting the
+  core clock through Sleep. The cycle counter may stop while the core
+  sleeps, so it is wound forward by the time slept to keep the system timer
+  in step.
+*/
+#if (configUSE_TICKLESS_IDLE == 2)
+/* SysTick counts lost while it is stopped to be reloaded */
+#define TICKLESS_STOPPED_COUNTS   94U
+#endif
+
+static osKernelIdleStats_t KernelIdleStats;
+
+#if (configUSE_TICKLESS_IDLE == 2)
+void vOS2SuppressTicksAndSleep (TickType_t xExpectedIdleTime) {
+  TickType_t idle, ticks;
+  uint32_t tick_counts, left, done, reload, slept;
+#if (SYSTIMER_DWT == 1)
+  uint32_t start;                       /* Cycle count, then cycles counted */
+#endif
+
+  tick_counts = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+  /* Sleep no longer than SysTick can count */
+  if (xExpectedIdleTime > (SysTick_LOAD_RELOAD_Msk / tick_counts)) {
+    xExpectedIdleTime = SysTick_LOAD_RELOAD_Msk / tick_counts;
+  }
+
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  /* A thread may have been readied by an interrupt since idle was entered */
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+    KernelIdleStats.aborted += 1U;
+    __enable_irq();
+    return;
+  }
+
+  /* Stop SysTick without reading CTRL, which would clear COUNTFLAG, and
+     reload it to count out the rest of this tick plus the ticks to sleep */
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk;
+
+  left = SysTick->VAL;
+  if (left == 0U) {
+    left = tick_counts;
+  }
+  reload = left + (tick_counts * (xExpectedIdleTime - 1U));
+
+  /* A tick that is already pending is skipped, and slept through instead */
+  if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U) {
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    reload -= tick_counts;
+  }
+  if (reload > TICKLESS_STOPPED_COUNTS) {
+    reload -= TICKLESS_STOPPED_COUNTS;
+  }
+
+  SysTick->LOAD = reload;
+  SysTick->VAL  = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+#if (SYSTIMER_DWT == 1)
+  start = DWT->CYCCNT;
+#endif
+
+  /* The hook may set idle to 0 if it has waited for an interrupt itself */
+  idle = xExpectedIdleTime;
+  configPRE_SLEEP_PROCESSING(idle);
+  if (idle > 0U) {
+    __DSB();
+    __WFI();
+    __ISB();
+  }
+
+  /* Let the interrupt that woke the core run, then stop SysTick again */
+  __enable_irq();
+  __DSB();
+  __ISB();
+  __disable_irq();
+  __DSB();
+  __ISB();
+
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk;
+#if (SYSTIMER_DWT == 1)
+  start = DWT->CYCCNT - start;
+#endif
+
+  if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0U) {
+    /* The sleep ran its full length: the tick it ended with is pending,
+       so step one tick less and count out the rest of the new tick */
+    slept  = reload + (reload - SysTick->VAL);
+    left   = (tick_counts - 1U) - (reload - SysTick->VAL);
+    if ((left <= TICKLESS_STOPPED_COUNTS) || (left > tick_counts)) {
+      left = tick_counts - 1U;
+    }
+    SysTick->LOAD = left;
+    ticks = xExpectedIdleTime - 1U;
+  }
+  else {
+    /* Another interrupt ended the sleep early: step the whole ticks slept
+       and count out the rest of the tick in progress */
+    slept = reload - SysTick->VAL;
+    done  = (xExpectedIdleTime * tick_counts) - SysTick->VAL;
+    ticks = done / tick_counts;
+    SysTick->LOAD = ((ticks + 1U) * tick_counts) - done;
+    KernelIdleStats.early += 1U;
+  }
+
+  SysTick->VAL  = 0U;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+  vTaskStepTick(ticks);
+  SysTick->LOAD = tick_counts - 1U;
+
+#if (SYSTIMER_DWT == 1)
+  /* Wind the cycle counter on over the cycles it did not count */
+  if (slept > start) {
+    DWT->CYCCNT += slept - start;
+  }
+#endif
+  KernelIdleStats.sleeps     += 1U;
+  KernelIdleStats.sleep_time += slept;
+
+  /* Runs once the tick count and system timer are up to date */
+  configPOST_SLEEP_PROCESSING(xExpectedIdleTime);
+
+  __enable_irq();
+}
+#endif /* (configUSE_TICKLESS_IDLE == 2) */
+
+void osKernelGetIdleStats (osKernelIdleStats_t *stats) {
+
+  if (stats != NULL) {
+    taskENTER_CRITICAL();
+    *stats = KernelIdleStats;
+    taskEXIT_CRITICAL();
+  }
+}
+
 /*---------------------------------------------------------------------------*/
 
 osThreadId_t osThreadNew (osThreadFunc_t func, void *argument, const osThreadAttr_t *attr) {
@@ -447,6 +1058,7 @@ osThreadId_t osThreadNew (osThreadFunc_t func, void *argument, const osThreadAtt
   TaskHandle_t hTask;
   UBaseType_t prio;
   int32_t mem;
+  SlabThread_t *slot;
 
   hTask = NULL;
 
@@ -497,9 +1109,32 @@ osThreadId_t osThreadNew (osThreadFunc_t func, void *argument, const osThreadAtt
     }
     else {
       if (mem == 0) {
+        slot = NULL;
+
+        #if (configSUPPORT_STATIC_ALLOCATION == 1)
+          /* Control block from the thread slab, stack from the heap */
+          slot = SlabAlloc (SLAB_THREAD);
+
+          if (slot != NULL) {
+            slot->stack = pvPortMalloc (stack * sizeof(StackType_t));
+
+            if (slot->stack != NULL) {
+              hTask = xTaskCreateStatic ((TaskFunction_t)func, name, stack, argument, prio, slot->stack, &slot->tcb);
+            }
+
+            if (hTask == NULL) {
+              vPortFree (slot->stack);
+              (void)SlabFree (SLAB_THREAD, slot);
+            }
+          }
+        #endif
+
         #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
-          if (xTaskCreate ((TaskFunction_t)func, name, (uint16_t)stack, argument, prio, &hTask) != pdPASS) {
-            hTask = NULL;
+          if (slot == NULL) {
+            /* Thread slab is full */
+            if (xTaskCreate ((TaskFunction_t)func, name, (uint16_t)stack, argument, prio, &hTask) != pdPASS) {
+              hTask = NULL;
+            }
           }
         #endif
       }
@@ -702,7 +1337,13 @@ uint32_t osThreadEnumerate (osThreadId_t *thread_array, uint32_t array_items) {
 
   if (IS_IRQ() || (thread_array == NULL) || (array_items == 0U)) {
     count = 0U;
-  } else {
+  }
+  else if ((ThreadRegistry.tracked != 0U) && (ThreadRegistry.untracked == 0U)) {
+    /* Every thread is in the registry: no allocation, no scheduler suspension */
+    i = 0U;
+    count = osThreadEnumerateNext (&i, thread_array, array_items);
+  }
+  else {
     vTaskSuspendAll();
 
     count = uxTaskGetNumberOfTasks();
@@ -723,90 +1364,172 @@ uint32_t osThreadEnumerate (osThreadId_t *thread_array, uint32_t array_items) {
 
   return (count);
 }
-#endif /* (configUSE_OS2_THREAD_ENUMERATE == 1) */
 
-#if (configUSE_OS2_THREAD_FLAGS == 1)
-uint32_t osThreadFlagsSet (osThreadId_t thread_id, uint32_t flags) {
-  TaskHandle_t hTask = (TaskHandle_t)thread_id;
-  uint32_t rflags;
-  BaseType_t yield;
+uint32_t osThreadEnumerateNext (uint32_t *cursor, osThreadId_t *thread_array, uint32_t array_items) {
+  uint32_t i, end, count;
 
-  if ((hTask == NULL) || ((flags & THREAD_FLAGS_INVALID_BITS) != 0U)) {
-    rflags = (uint32_t)osErrorParameter;
-  }
-  else {
-    rflags = (uint32_t)osError;
+  count = 0U;
 
-    if (IS_IRQ()) {
-      yield = pdFALSE;
+  if (!IS_IRQ() && (cursor != NULL) && (thread_array != NULL)) {
+    i = *cursor;
 
-      (void)xTaskNotifyFromISR (hTask, flags, eSetBits, &yield);
-      (void)xTaskNotifyAndQueryFromISR (hTask, 0, eNoAction, &rflags, NULL);
+    while ((count < array_items) && (i < configOS2_THREAD_REGISTRY_SIZE)) {
+      /* Scan a bounded number of slots per critical section */
+      end = i + THREAD_REGISTRY_CHUNK;
 
-      portYIELD_FROM_ISR (yield);
-    }
-    else {
-      (void)xTaskNotify (hTask, flags, eSetBits);
-      (void)xTaskNotifyAndQuery (hTask, 0, eNoAction, &rflags);
+      if (end > configOS2_THREAD_REGISTRY_SIZE) {
+        end = configOS2_THREAD_REGISTRY_SIZE;
+      }
+
+      taskENTER_CRITICAL();
+
+      for (; (i < end) && (count < array_items); i++) {
+        if (ThreadRegistry.task[i] != NULL) {
+          thread_array[count] = (osThreadId_t)ThreadRegistry.task[i];
+          count++;
+        }
+      }
+
+      taskEXIT_CRITICAL();
     }
+
+    *cursor = i;
   }
-  /* Return flags after setting */
-  return (rflags);
+
+  return (count);
 }
+#endif /* (configUSE_OS2_THREAD_ENUMERATE == 1) */
 
-uint32_t osThreadFlagsClear (uint32_t flags) {
-  TaskHandle_t hTask;
-  uint32_t rflags, cflags;
+#if (configUSE_OS2_THREAD_FLAGS == 1)
+/*
+  Thread flags
+
+  Each thread uses three task notifications. THREAD_FLAGS_INDEX holds the
+  thread flags. A thread waiting for flags stores its wait condition (the
+  flags, plus THREAD_FLAGS_WAIT_ALL for osFlagsWaitAll) in THREAD_WAIT_INDEX
+  and blocks on THREAD_WAKE_INDEX. osThreadFlagsSet only notifies the wake
+  index once the condition is met, so a thread waiting for several flags is
+  not woken, and switched to, for every flag set on the way.
+*/
+#define THREAD_FLAGS_INDEX        0U
+#define THREAD_WAKE_INDEX         1U
+#define THREAD_WAIT_INDEX         2U
 
-  if (IS_IRQ()) {
-    rflags = (uint32_t)osErrorISR;
+#define THREAD_FLAGS_WAIT_ALL     (1UL << MAX_BITS_TASK_NOTIFY)
+
+static osThreadFlagsStats_t ThreadFlagsStats;
+
+/*
+  Check thread flags against a wait condition. Return 0 if the condition is
+  not met or there is no waiting thread.
+*/
+static uint32_t ThreadFlagsMet (uint32_t rflags, uint32_t wait) {
+  uint32_t flags, met;
+
+  flags = wait & ~THREAD_FLAGS_WAIT_ALL;
+
+  if ((wait & THREAD_FLAGS_WAIT_ALL) != 0U) {
+    met = ((flags != 0U) && ((rflags & flags) == flags)) ? 1U : 0U;
+  } else {
+    met = ((rflags & flags) != 0U) ? 1U : 0U;
   }
-  else if ((flags & THREAD_FLAGS_INVALID_BITS) != 0U) {
+
+  return (met);
+}
+
+uint32_t osThreadFlagsSet (osThreadId_t thread_id, uint32_t flags) {
+  TaskHandle_t hTask = (TaskHandle_t)thread_id;
+  uint32_t rflags, wait;
+  UBaseType_t isrm;
+  BaseType_t yield;
+
+  if ((hTask == NULL) || ((flags & THREAD_FLAGS_INVALID_BITS) != 0U)) {
     rflags = (uint32_t)osErrorParameter;
   }
   else {
-    hTask = xTaskGetCurrentTaskHandle();
+    rflags = (uint32_t)osError;
+
+    if (IS_IRQ()) {
+      yield = pdFALSE;
+      isrm  = taskENTER_CRITICAL_FROM_ISR();
 
-    if (xTaskNotifyAndQuery (hTask, 0, eNoAction, &cflags) == pdPASS) {
-      rflags = cflags;
-      cflags &= ~flags;
+      (void)xTaskNotifyAndQueryIndexedFromISR (hTask, THREAD_FLAGS_INDEX, flags, eSetBits, &rflags, NULL);
+      (void)xTaskNotifyAndQueryIndexedFromISR (hTask, THREAD_WAIT_INDEX, 0U, eNoAction, &wait, NULL);
+      rflags |= flags;
 
-      if (xTaskNotify (hTask, cflags, eSetValueWithOverwrite) != pdPASS) {
-        rflags = (uint32_t)osError;
+      if (ThreadFlagsMet (rflags, wait) != 0U) {
+        /* Wait condition met: withdraw it and wake the thread */
+        (void)xTaskNotifyIndexedFromISR (hTask, THREAD_WAIT_INDEX, 0U, eSetValueWithOverwrite, NULL);
+        (void)xTaskNotifyIndexedFromISR (hTask, THREAD_WAKE_INDEX, 0U, eNoAction, &yield);
+        ThreadFlagsStats.wakeups += 1U;
+      }
+      else if (wait != 0U) {
+        ThreadFlagsStats.deferred += 1U;
       }
+
+      taskEXIT_CRITICAL_FROM_ISR(isrm);
+      portYIELD_FROM_ISR (yield);
     }
     else {
-      rflags = (uint32_t)osError;
+      taskENTER_CRITICAL();
+
+      (void)xTaskNotifyAndQueryIndexed (hTask, THREAD_FLAGS_INDEX, flags, eSetBits, &rflags);
+      wait    = ulTaskNotifyValueClearIndexed (hTask, THREAD_WAIT_INDEX, 0U);
+      rflags |= flags;
+
+      if (ThreadFlagsMet (rflags, wait) != 0U) {
+        /* Wait condition met: withdraw it and wake the thread */
+        (void)ulTaskNotifyValueClearIndexed (hTask, THREAD_WAIT_INDEX, wait);
+        (void)xTaskNotifyIndexed (hTask, THREAD_WAKE_INDEX, 0U, eNoAction);
+        ThreadFlagsStats.wakeups += 1U;
+      }
+      else if (wait != 0U) {
+        ThreadFlagsStats.deferred += 1U;
+      }
+
+      taskEXIT_CRITICAL();
     }
   }
+  /* Return flags after setting */
+  return (rflags);
+}
+
+uint32_t osThreadFlagsClear (uint32_t flags) {
+  uint32_t rflags;
+
+  if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else if ((flags & THREAD_FLAGS_INVALID_BITS) != 0U) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else {
+    rflags = ulTaskNotifyValueClearIndexed (NULL, THREAD_FLAGS_INDEX, flags);
+  }
 
   /* Return flags before clearing */
   return (rflags);
 }
 
 uint32_t osThreadFlagsGet (void) {
-  TaskHandle_t hTask;
   uint32_t rflags;
 
   if (IS_IRQ()) {
     rflags = (uint32_t)osErrorISR;
   }
   else {
-    hTask = xTaskGetCurrentTaskHandle();
-
-    if (xTaskNotifyAndQuery (hTask, 0, eNoAction, &rflags) != pdPASS) {
-      rflags = (uint32_t)osError;
-    }
+    rflags = ulTaskNotifyValueClearIndexed (NULL, THREAD_FLAGS_INDEX, 0U);
   }
 
   return (rflags);
 }
 
 uint32_t osThreadFlagsWait (uint32_t flags, uint32_t options, uint32_t timeout) {
-  uint32_t rflags, nval;
-  uint32_t clear;
-  TickType_t t0, td, tout;
-  BaseType_t rval;
+  TaskHandle_t hTask;
+  uint32_t rflags, wait;
+  uint32_t woken, blocked;
+  TickType_t tout;
+  TimeOut_t tstate;
 
   if (IS_IRQ()) {
     rflags = (uint32_t)osErrorISR;
@@ -815,67 +1538,76 @@ uint32_t osThreadFlagsWait (uint32_t flags, uint32_t options, uint32_t timeout)
     rflags = (uint32_t)osErrorParameter;
   }
   else {
-    if ((options & osFlagsNoClear) == osFlagsNoClear) {
-      clear = 0U;
+    hTask = xTaskGetCurrentTaskHandle();
+
+    if ((options & osFlagsWaitAll) == osFlagsWaitAll) {
+      wait = flags | THREAD_FLAGS_WAIT_ALL;
     } else {
-      clear = flags;
+      wait = flags;
     }
 
-    rflags = 0U;
-    tout   = timeout;
+    tout  = timeout;
+    woken = 0U;
+    vTaskSetTimeOutState (&tstate);
 
-    t0 = xTaskGetTickCount();
     do {
-      rval = xTaskNotifyWait (0, clear, &nval, tout);
+      blocked = 0U;
 
-      if (rval == pdPASS) {
-        rflags &= flags;
-        rflags |= nval;
+      taskENTER_CRITICAL();
 
-        if ((options & osFlagsWaitAll) == osFlagsWaitAll) {
-          if ((flags & rflags) == flags) {
-            break;
-          } else {
-            if (timeout == 0U) {
-              rflags = (uint32_t)osErrorResource;
-              break;
-            }
-          }
-        }
-        else {
-          if ((flags & rflags) != 0) {
-            break;
-          } else {
-            if (timeout == 0U) {
-              rflags = (uint32_t)osErrorResource;
-              break;
-            }
-          }
-        }
-
-        /* Update timeout */
-        td = xTaskGetTickCount() - t0;
+      /* Withdraw the wait condition, in case the wait timed out */
+      (void)ulTaskNotifyValueClearIndexed (hTask, THREAD_WAIT_INDEX, 0xFFFFFFFFU);
+      rflags = ulTaskNotifyValueClearIndexed (hTask, THREAD_FLAGS_INDEX, 0U);
 
-        if (td > tout) {
-          tout  = 0;
-        } else {
-          tout -= td;
+      if (ThreadFlagsMet (rflags, wait) != 0U) {
+        if ((options & osFlagsNoClear) != osFlagsNoClear) {
+          (void)ulTaskNotifyValueClearIndexed (hTask, THREAD_FLAGS_INDEX, flags);
         }
       }
       else {
-        if (timeout == 0) {
+        if (woken != 0U) {
+          ThreadFlagsStats.spurious += 1U;
+        }
+
+        if (timeout == 0U) {
           rflags = (uint32_t)osErrorResource;
-        } else {
+        }
+        else if (tout == 0U) {
           rflags = (uint32_t)osErrorTimeout;
         }
+        else {
+          /* Publish the wait condition, then block until osThreadFlagsSet meets it */
+          (void)xTaskNotifyStateClearIndexed (hTask, THREAD_WAKE_INDEX);
+          (void)xTaskNotifyIndexed (hTask, THREAD_WAIT_INDEX, wait, eSetValueWithOverwrite);
+          blocked = 1U;
+        }
+      }
+
+      taskEXIT_CRITICAL();
+
+      if (blocked != 0U) {
+        woken = (uint32_t)xTaskNotifyWaitIndexed (THREAD_WAKE_INDEX, 0U, 0U, NULL, tout);
+
+        if (xTaskCheckForTimeOut (&tstate, &tout) != pdFALSE) {
+          tout = 0U;
+        }
       }
     }
-    while (rval != pdFAIL);
+    while (blocked != 0U);
   }
 
   /* Return flags before clearing */
   return (rflags);
 }
+
+void osThreadFlagsGetStats (osThreadFlagsStats_t *stats) {
+
+  if (stats != NULL) {
+    taskENTER_CRITICAL();
+    *stats = ThreadFlagsStats;
+    taskEXIT_CRITICAL();
+  }
+}
 #endif /* (configUSE_OS2_THREAD_FLAGS == 1) */
 
 osStatus_t osDelay (uint32_t ticks) {
@@ -940,14 +1672,50 @@ osTimerId_t osTimerNew (osTimerFunc_t func, osTimerType_t type, void *argument,
   const char *name;
   TimerHandle_t hTimer;
   TimerCallback_t *callb;
+  SlabTimer_t *slot;
   UBaseType_t reload;
   int32_t mem;
 
   hTimer = NULL;
 
   if (!IS_IRQ() && (func != NULL)) {
-    /* Allocate memory to store callback function and argument */
-    callb = pvPortMalloc (sizeof(TimerCallback_t));
+    mem  = -1;
+    name = NULL;
+    slot = NULL;
+
+    if (attr != NULL) {
+      if (attr->name != NULL) {
+        name = attr->name;
+      }
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(StaticTimer_t))) {
+        mem = 1;
+      }
+      else {
+        if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+          mem = 0;
+        }
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    #if (configSUPPORT_STATIC_ALLOCATION == 1)
+    if (mem == 0) {
+      /* Timer and callback information from the timer slab, after
+         reclaiming slots of timers deleted while the command queue was full */
+      SlabTimerReclaim (NULL);
+      slot = SlabAlloc (SLAB_TIMER);
+    }
+    #endif
+
+    if (slot != NULL) {
+      callb = &slot->callb;
+    } else {
+      /* Allocate memory to store callback function and argument */
+      callb = pvPortMalloc (sizeof(TimerCallback_t));
+    }
 
     if (callb != NULL) {
       callb->func = func;
@@ -959,28 +1727,12 @@ osTimerId_t osTimerNew (osTimerFunc_t func, osTimerType_t type, void *argument,
         reload = pdTRUE;
       }
 
-      mem  = -1;
-      name = NULL;
-
-      if (attr != NULL) {
-        if (attr->name != NULL) {
-          name = attr->name;
-        }
-
-        if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(StaticTimer_t))) {
-          mem = 1;
-        }
-        else {
-          if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
-            mem = 0;
-          }
-        }
-      }
-      else {
-        mem = 0;
+      if (slot != NULL) {
+        #if (configSUPPORT_STATIC_ALLOCATION == 1)
+          hTimer = xTimerCreateStatic (name, 1, reload, callb, TimerCallback, &slot->timer);
+        #endif
       }
-
-      if (mem == 1) {
+      else if (mem == 1) {
         #if (configSUPPORT_STATIC_ALLOCATION == 1)
           hTimer = xTimerCreateStatic (name, 1, reload, callb, TimerCallback, (StaticTimer_t *)attr->cb_mem);
         #endif
@@ -993,8 +1745,12 @@ osTimerId_t osTimerNew (osTimerFunc_t func, osTimerType_t type, void *argument,
         }
       }
 
-      if ((hTimer == NULL) && (callb != NULL)) {
-        vPortFree (callb);
+      if (hTimer == NULL) {
+        if (slot != NULL) {
+          (void)SlabFree (SLAB_TIMER, slot);
+        } else {
+          vPortFree (callb);
+        }
       }
     }
   }
@@ -1091,7 +1847,13 @@ osStatus_t osTimerDelete (osTimerId_t timer_id) {
     callb = (TimerCallback_t *)pvTimerGetTimerID (hTimer);
 
     if (xTimerDelete (hTimer, 0) == pdPASS) {
-      vPortFree (callb);
+      if (SlabOwns (SLAB_TIMER, hTimer) != 0U) {
+        /* The timer service task still has to process the delete command:
+           queue the slot's release behind it, without blocking */
+        SlabTimerReclaim ((SlabTimer_t *)hTimer);
+      } else {
+        vPortFree (callb);
+      }
       stat = osOK;
     } else {
       stat = osErrorResource;
@@ -1106,18 +1868,93 @@ osStatus_t osTimerDelete (osTimerId_t timer_id) {
 #endif /* (configUSE_OS2_TIMER == 1) */
 
 /*---------------------------------------------------------------------------*/
+#if (configOS2_EVENTFLAGS_DIRECT == 1)
+/*
+  Event flags
+
+  Event flags are kept here rather than in a FreeRTOS event group. A
+  waiting thread links a record of its wait condition into the object and
+  blocks on task notification EVENT_FLAGS_WAKE_INDEX. osEventFlagsSet checks
+  the waiters inside a critical section and notifies those whose condition
+  is met. From an ISR this wakes them directly, where
+  xEventGroupSetBitsFromISR defers the work to the timer daemon task. The
+  wake index is the one osThreadFlagsWait blocks on: a thread is only ever
+  in one of the two waits, and both clear the notification before blocking.
+*/
+#define EVENT_FLAGS_WAKE_INDEX    1U
+
+/*
+  Check event flags against a wait condition. Return 0 if it is not met.
+*/
+static uint32_t EventFlagsMet (uint32_t rflags, uint32_t flags, uint32_t options) {
+  uint32_t met;
+
+  if ((options & osFlagsWaitAll) == osFlagsWaitAll) {
+    met = ((rflags & flags) == flags) ? 1U : 0U;
+  } else {
+    met = ((rflags & flags) != 0U) ? 1U : 0U;
+  }
+
+  return (met);
+}
+
+/*
+  Set event flags and wake the waiting threads whose condition they meet.
+  Flags are cleared for those threads once every waiter has been checked.
+  Called in a critical section; yield is NULL unless called from an ISR.
+  The whole list is walked in that one section, so the time interrupts stay
+  masked grows with the number of waiters (see freertos_os2.h).
+*/
+static uint32_t EventFlagsRelease (EventFlags_t *ef, uint32_t flags, BaseType_t *yield) {
+  EventFlagsWaiter_t **link, *waiter;
+  TaskHandle_t hTask;
+  uint32_t rflags, clear;
+
+  rflags = ef->flags | flags;
+  clear  = 0U;
+  link   = &ef->waiters;
+
+  while (*link != NULL) {
+    waiter = *link;
+
+    if (EventFlagsMet (rflags, waiter->flags, waiter->options) != 0U) {
+      if ((waiter->options & osFlagsNoClear) != osFlagsNoClear) {
+        clear |= waiter->flags;
+      }
+
+      /* Unlink the waiter, then wake its thread */
+      *link          = waiter->next;
+      hTask          = waiter->task;
+      waiter->rflags = rflags;
+      waiter->task   = NULL;
+
+      if (yield != NULL) {
+        (void)xTaskNotifyIndexedFromISR (hTask, EVENT_FLAGS_WAKE_INDEX, 0U, eNoAction, yield);
+      } else {
+        (void)xTaskNotifyIndexed (hTask, EVENT_FLAGS_WAKE_INDEX, 0U, eNoAction);
+      }
+    }
+    else {
+      link = &waiter->next;
+    }
+  }
+
+  ef->flags = rflags & ~clear;
+
+  return (rflags);
+}
 
 osEventFlagsId_t osEventFlagsNew (const osEventFlagsAttr_t *attr) {
-  EventGroupHandle_t hEventGroup;
+  EventFlags_t *ef;
   int32_t mem;
 
-  hEventGroup = NULL;
+  ef = NULL;
 
   if (!IS_IRQ()) {
     mem = -1;
 
     if (attr != NULL) {
-      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(StaticEventGroup_t))) {
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(EventFlags_t))) {
         mem = 1;
       }
       else {
@@ -1131,140 +1968,402 @@ osEventFlagsId_t osEventFlagsNew (const osEventFlagsAttr_t *attr) {
     }
 
     if (mem == 1) {
-      #if (configSUPPORT_STATIC_ALLOCATION == 1)
-      hEventGroup = xEventGroupCreateStatic (attr->cb_mem);
-      #endif
+      ef = attr->cb_mem;
+      ef->status = 0U;
     }
     else {
       if (mem == 0) {
-        #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
-          hEventGroup = xEventGroupCreate();
-        #endif
+        ef = CBAlloc (SLAB_EVENTFLAGS, sizeof(EventFlags_t));
+
+        if (ef != NULL) {
+          ef->status = 1U;
+        }
       }
     }
+
+    if (ef != NULL) {
+      ef->flags   = 0U;
+      ef->waiters = NULL;
+    }
   }
 
-  return ((osEventFlagsId_t)hEventGroup);
+  return ((osEventFlagsId_t)ef);
 }
 
 uint32_t osEventFlagsSet (osEventFlagsId_t ef_id, uint32_t flags) {
-  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  EventFlags_t *ef = (EventFlags_t *)ef_id;
   uint32_t rflags;
+  UBaseType_t isrm;
   BaseType_t yield;
 
-  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
     rflags = (uint32_t)osErrorParameter;
   }
   else if (IS_IRQ()) {
   #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 0)
+    (void)isrm;
     (void)yield;
-    /* Enable timers and xTimerPendFunctionCall function to support osEventFlagsSet from ISR */
     rflags = (uint32_t)osErrorResource;
   #else
     yield = pdFALSE;
+    isrm  = taskENTER_CRITICAL_FROM_ISR();
 
-    if (xEventGroupSetBitsFromISR (hEventGroup, (EventBits_t)flags, &yield) == pdFAIL) {
-      rflags = (uint32_t)osErrorResource;
-    } else {
-      rflags = flags;
-      portYIELD_FROM_ISR (yield);
-    }
+    rflags = EventFlagsRelease (ef, flags, &yield);
+
+    taskEXIT_CRITICAL_FROM_ISR(isrm);
+    portYIELD_FROM_ISR (yield);
   #endif
   }
   else {
-    rflags = xEventGroupSetBits (hEventGroup, (EventBits_t)flags);
+    taskENTER_CRITICAL();
+    rflags = EventFlagsRelease (ef, flags, NULL);
+    taskEXIT_CRITICAL();
   }
 
+  /* Return flags after setting */
   return (rflags);
 }
 
 uint32_t osEventFlagsClear (osEventFlagsId_t ef_id, uint32_t flags) {
-  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  EventFlags_t *ef = (EventFlags_t *)ef_id;
   uint32_t rflags;
+  UBaseType_t isrm;
 
-  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
     rflags = (uint32_t)osErrorParameter;
   }
   else if (IS_IRQ()) {
   #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 0)
-    /* Enable timers and xTimerPendFunctionCall function to support osEventFlagsSet from ISR */
+    (void)isrm;
     rflags = (uint32_t)osErrorResource;
   #else
-    rflags = xEventGroupGetBitsFromISR (hEventGroup);
+    isrm = taskENTER_CRITICAL_FROM_ISR();
 
-    if (xEventGroupClearBitsFromISR (hEventGroup, (EventBits_t)flags) == pdFAIL) {
-      rflags = (uint32_t)osErrorResource;
-    }
+    rflags    = ef->flags;
+    ef->flags = rflags & ~flags;
+
+    taskEXIT_CRITICAL_FROM_ISR(isrm);
   #endif
   }
   else {
-    rflags = xEventGroupClearBits (hEventGroup, (EventBits_t)flags);
+    taskENTER_CRITICAL();
+
+    rflags    = ef->flags;
+    ef->flags = rflags & ~flags;
+
+    taskEXIT_CRITICAL();
   }
 
+  /* Return flags before clearing */
   return (rflags);
 }
 
 uint32_t osEventFlagsGet (osEventFlagsId_t ef_id) {
-  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  EventFlags_t *ef = (EventFlags_t *)ef_id;
   uint32_t rflags;
 
-  if (ef_id == NULL) {
+  if (ef == NULL) {
     rflags = 0U;
   }
-  else if (IS_IRQ()) {
-    rflags = xEventGroupGetBitsFromISR (hEventGroup);
-  }
   else {
-    rflags = xEventGroupGetBits (hEventGroup);
+    rflags = ef->flags;
   }
 
   return (rflags);
 }
 
 uint32_t osEventFlagsWait (osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout) {
-  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
-  BaseType_t wait_all;
-  BaseType_t exit_clr;
-  uint32_t rflags;
+  EventFlags_t *ef = (EventFlags_t *)ef_id;
+  EventFlagsWaiter_t waiter, **link;
+  uint32_t rflags, blocked;
+  TickType_t tout;
+  TimeOut_t tstate;
 
-  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+  if ((ef == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
     rflags = (uint32_t)osErrorParameter;
   }
   else if (IS_IRQ()) {
     rflags = (uint32_t)osErrorISR;
   }
   else {
-    if (options & osFlagsWaitAll) {
-      wait_all = pdTRUE;
-    } else {
-      wait_all = pdFAIL;
-    }
+    tout    = timeout;
+    blocked = 0U;
+    vTaskSetTimeOutState (&tstate);
 
-    if (options & osFlagsNoClear) {
-      exit_clr = pdFAIL;
-    } else {
-      exit_clr = pdTRUE;
-    }
+    taskENTER_CRITICAL();
 
-    rflags = xEventGroupWaitBits (hEventGroup, (EventBits_t)flags, exit_clr, wait_all, (TickType_t)timeout);
+    rflags = ef->flags;
 
-    if (options & osFlagsWaitAll) {
-      if ((flags & rflags) != flags) {
-        if (timeout > 0U) {
-          rflags = (uint32_t)osErrorTimeout;
-        } else {
-          rflags = (uint32_t)osErrorResource;
-        }
+    if (EventFlagsMet (rflags, flags, options) != 0U) {
+      if ((options & osFlagsNoClear) != osFlagsNoClear) {
+        ef->flags = rflags & ~flags;
       }
     }
-    else {
-      if ((flags & rflags) == 0U) {
-        if (timeout > 0U) {
-          rflags = (uint32_t)osErrorTimeout;
-        } else {
-          rflags = (uint32_t)osErrorResource;
-        }
-      }
+    else if (timeout == 0U) {
+      rflags = (uint32_t)osErrorResource;
+    }
+    else {
+      /* Join the end of the waiting list, then block until woken */
+      waiter.next    = NULL;
+      waiter.task    = xTaskGetCurrentTaskHandle();
+      waiter.flags   = flags;
+      waiter.options = options;
+
+      for (link = &ef->waiters; *link != NULL; link = &(*link)->next);
+      *link = &waiter;
+
+      (void)xTaskNotifyStateClearIndexed (NULL, EVENT_FLAGS_WAKE_INDEX);
+      blocked = 1U;
+    }
+
+    taskEXIT_CRITICAL();
+
+    while (blocked != 0U) {
+      (void)xTaskNotifyWaitIndexed (EVENT_FLAGS_WAKE_INDEX, 0U, 0U, NULL, tout);
+
+      if (xTaskCheckForTimeOut (&tstate, &tout) != pdFALSE) {
+        tout = 0U;
+      }
+
+      taskENTER_CRITICAL();
+
+      if (waiter.task == NULL) {
+        /* Woken by osEventFlagsSet or osEventFlagsDelete */
+        rflags  = waiter.rflags;
+        blocked = 0U;
+      }
+      else if (tout == 0U) {
+        /* Timed out: leave the waiting list */
+        for (link = &ef->waiters; *link != &waiter; link = &(*link)->next);
+        *link = waiter.next;
+
+        rflags  = (uint32_t)osErrorTimeout;
+        blocked = 0U;
+      }
+
+      taskEXIT_CRITICAL();
+    }
+  }
+
+  return (rflags);
+}
+
+osStatus_t osEventFlagsDelete (osEventFlagsId_t ef_id) {
+  EventFlags_t *ef = (EventFlags_t *)ef_id;
+  EventFlagsWaiter_t *waiter;
+  TaskHandle_t hTask;
+  osStatus_t stat;
+
+#ifndef USE_FreeRTOS_HEAP_1
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if (ef == NULL) {
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osOK;
+
+    taskENTER_CRITICAL();
+
+    /* Wake any waiting threads with an error */
+    while (ef->waiters != NULL) {
+      waiter      = ef->waiters;
+      ef->waiters = waiter->next;
+      hTask       = waiter->task;
+
+      waiter->rflags = (uint32_t)osErrorResource;
+      waiter->task   = NULL;
+      (void)xTaskNotifyIndexed (hTask, EVENT_FLAGS_WAKE_INDEX, 0U, eNoAction);
+    }
+
+    taskEXIT_CRITICAL();
+
+    if ((ef->status & 1U) != 0U) {
+      /* Control block allocated on heap or in the slab */
+      CBFree (SLAB_EVENTFLAGS, ef);
+    }
+  }
+#else
+  stat = osError;
+#endif
+
+  return (stat);
+}
+
+#else /* (configOS2_EVENTFLAGS_DIRECT == 0) */
+
+osEventFlagsId_t osEventFlagsNew (const osEventFlagsAttr_t *attr) {
+  EventGroupHandle_t hEventGroup;
+  StaticEventGroup_t *slot;
+  int32_t mem;
+
+  hEventGroup = NULL;
+
+  if (!IS_IRQ()) {
+    mem = -1;
+
+    if (attr != NULL) {
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(StaticEventGroup_t))) {
+        mem = 1;
+      }
+      else {
+        if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+          mem = 0;
+        }
+      }
+    }
+    else {
+      mem = 0;
+    }
+
+    if (mem == 1) {
+      #if (configSUPPORT_STATIC_ALLOCATION == 1)
+      hEventGroup = xEventGroupCreateStatic (attr->cb_mem);
+      #endif
+    }
+    else {
+      if (mem == 0) {
+        slot = NULL;
+
+        #if (configSUPPORT_STATIC_ALLOCATION == 1)
+          slot = SlabAlloc (SLAB_EVENTFLAGS);
+
+          if (slot != NULL) {
+            hEventGroup = xEventGroupCreateStatic (slot);
+          }
+        #endif
+
+        #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
+          if (slot == NULL) {
+            hEventGroup = xEventGroupCreate();
+          }
+        #endif
+      }
+    }
+  }
+
+  return ((osEventFlagsId_t)hEventGroup);
+}
+
+uint32_t osEventFlagsSet (osEventFlagsId_t ef_id, uint32_t flags) {
+  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  uint32_t rflags;
+  BaseType_t yield;
+
+  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+  #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 0)
+    (void)yield;
+    /* Enable timers and xTimerPendFunctionCall function to support osEventFlagsSet from ISR */
+    rflags = (uint32_t)osErrorResource;
+  #else
+    yield = pdFALSE;
+
+    if (xEventGroupSetBitsFromISR (hEventGroup, (EventBits_t)flags, &yield) == pdFAIL) {
+      rflags = (uint32_t)osErrorResource;
+    } else {
+      rflags = flags;
+      portYIELD_FROM_ISR (yield);
+    }
+  #endif
+  }
+  else {
+    rflags = xEventGroupSetBits (hEventGroup, (EventBits_t)flags);
+  }
+
+  return (rflags);
+}
+
+uint32_t osEventFlagsClear (osEventFlagsId_t ef_id, uint32_t flags) {
+  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  uint32_t rflags;
+
+  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+  #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 0)
+    /* Enable timers and xTimerPendFunctionCall function to support osEventFlagsSet from ISR */
+    rflags = (uint32_t)osErrorResource;
+  #else
+    rflags = xEventGroupGetBitsFromISR (hEventGroup);
+
+    if (xEventGroupClearBitsFromISR (hEventGroup, (EventBits_t)flags) == pdFAIL) {
+      rflags = (uint32_t)osErrorResource;
+    }
+  #endif
+  }
+  else {
+    rflags = xEventGroupClearBits (hEventGroup, (EventBits_t)flags);
+  }
+
+  return (rflags);
+}
+
+uint32_t osEventFlagsGet (osEventFlagsId_t ef_id) {
+  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  uint32_t rflags;
+
+  if (ef_id == NULL) {
+    rflags = 0U;
+  }
+  else if (IS_IRQ()) {
+    rflags = xEventGroupGetBitsFromISR (hEventGroup);
+  }
+  else {
+    rflags = xEventGroupGetBits (hEventGroup);
+  }
+
+  return (rflags);
+}
+
+uint32_t osEventFlagsWait (osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+  EventGroupHandle_t hEventGroup = (EventGroupHandle_t)ef_id;
+  BaseType_t wait_all;
+  BaseType_t exit_clr;
+  uint32_t rflags;
+
+  if ((hEventGroup == NULL) || ((flags & EVENT_FLAGS_INVALID_BITS) != 0U)) {
+    rflags = (uint32_t)osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    rflags = (uint32_t)osErrorISR;
+  }
+  else {
+    if (options & osFlagsWaitAll) {
+      wait_all = pdTRUE;
+    } else {
+      wait_all = pdFAIL;
+    }
+
+    if (options & osFlagsNoClear) {
+      exit_clr = pdFAIL;
+    } else {
+      exit_clr = pdTRUE;
+    }
+
+    rflags = xEventGroupWaitBits (hEventGroup, (EventBits_t)flags, exit_clr, wait_all, (TickType_t)timeout);
+
+    if (options & osFlagsWaitAll) {
+      if ((flags & rflags) != flags) {
+        if (timeout > 0U) {
+          rflags = (uint32_t)osErrorTimeout;
+        } else {
+          rflags = (uint32_t)osErrorResource;
+        }
+      }
+    }
+    else {
+      if ((flags & rflags) == 0U) {
+        if (timeout > 0U) {
+          rflags = (uint32_t)osErrorTimeout;
+        } else {
+          rflags = (uint32_t)osErrorResource;
+        }
+      }
     }
   }
 
@@ -1285,6 +2384,7 @@ osStatus_t osEventFlagsDelete (osEventFlagsId_t ef_id) {
   else {
     stat = osOK;
     vEventGroupDelete (hEventGroup);
+    (void)SlabFree (SLAB_EVENTFLAGS, hEventGroup);
   }
 #else
   stat = osError;
@@ -1292,12 +2392,14 @@ osStatus_t osEventFlagsDelete (osEventFlagsId_t ef_id) {
 
   return (stat);
 }
+#endif /* (configOS2_EVENTFLAGS_DIRECT == 1) */
 
 /*---------------------------------------------------------------------------*/
 #if (configUSE_OS2_MUTEX == 1)
 
 osMutexId_t osMutexNew (const osMutexAttr_t *attr) {
   SemaphoreHandle_t hMutex;
+  StaticSemaphore_t *slot;
   uint32_t type;
   uint32_t rmtx;
   int32_t  mem;
@@ -1351,13 +2453,36 @@ osMutexId_t osMutexNew (const osMutexAttr_t *attr) {
       }
       else {
         if (mem == 0) {
+          slot = NULL;
+
+          #if (configSUPPORT_STATIC_ALLOCATION == 1)
+            slot = SlabAlloc (SLAB_SEMAPHORE);
+
+            if (slot != NULL) {
+              if (rmtx != 0U) {
+                #if (configUSE_RECURSIVE_MUTEXES == 1)
+                hMutex = xSemaphoreCreateRecursiveMutexStatic (slot);
+                #endif
+              }
+              else {
+                hMutex = xSemaphoreCreateMutexStatic (slot);
+              }
+
+              if (hMutex == NULL) {
+                (void)SlabFree (SLAB_SEMAPHORE, slot);
+              }
+            }
+          #endif
+
           #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
-            if (rmtx != 0U) {
-              #if (configUSE_RECURSIVE_MUTEXES == 1)
-              hMutex = xSemaphoreCreateRecursiveMutex ();
-              #endif
-            } else {
-              hMutex = xSemaphoreCreateMutex ();
+            if (slot == NULL) {
+              if (rmtx != 0U) {
+                #if (configUSE_RECURSIVE_MUTEXES == 1)
+                hMutex = xSemaphoreCreateRecursiveMutex ();
+                #endif
+              } else {
+                hMutex = xSemaphoreCreateMutex ();
+              }
             }
           #endif
         }
@@ -1495,6 +2620,7 @@ osStatus_t osMutexDelete (osMutexId_t mutex_id) {
     #endif
     stat = osOK;
     vSemaphoreDelete (hMutex);
+    (void)SlabFree (SLAB_SEMAPHORE, hMutex);
   }
 #else
   stat = osError;
@@ -1508,6 +2634,7 @@ osStatus_t osMutexDelete (osMutexId_t mutex_id) {
 
 osSemaphoreId_t osSemaphoreNew (uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr) {
   SemaphoreHandle_t hSemaphore;
+  StaticSemaphore_t *slot;
   int32_t mem;
   #if (configQUEUE_REGISTRY_SIZE > 0)
   const char *name;
@@ -1533,10 +2660,22 @@ osSemaphoreId_t osSemaphoreNew (uint32_t max_count, uint32_t initial_count, cons
     }
 
     if (mem != -1) {
+      slot = NULL;
+
+      if (mem == 1) {
+        slot = (StaticSemaphore_t *)attr->cb_mem;
+      }
+      #if (configSUPPORT_STATIC_ALLOCATION == 1)
+      else {
+        /* Control block from the semaphore slab; NULL if it is full */
+        slot = SlabAlloc (SLAB_SEMAPHORE);
+      }
+      #endif
+
       if (max_count == 1U) {
-        if (mem == 1) {
+        if (slot != NULL) {
           #if (configSUPPORT_STATIC_ALLOCATION == 1)
-            hSemaphore = xSemaphoreCreateBinaryStatic ((StaticSemaphore_t *)attr->cb_mem);
+            hSemaphore = xSemaphoreCreateBinaryStatic (slot);
           #endif
         }
         else {
@@ -1553,9 +2692,9 @@ osSemaphoreId_t osSemaphoreNew (uint32_t max_count, uint32_t initial_count, cons
         }
       }
       else {
-        if (mem == 1) {
+        if (slot != NULL) {
           #if (configSUPPORT_STATIC_ALLOCATION == 1)
-            hSemaphore = xSemaphoreCreateCountingStatic (max_count, initial_count, (StaticSemaphore_t *)attr->cb_mem);
+            hSemaphore = xSemaphoreCreateCountingStatic (max_count, initial_count, slot);
           #endif
         }
         else {
@@ -1564,6 +2703,11 @@ osSemaphoreId_t osSemaphoreNew (uint32_t max_count, uint32_t initial_count, cons
           #endif
         }
       }
+
+      if ((hSemaphore == NULL) && (slot != NULL)) {
+        /* Release the slab slot, if that is where the control block came from */
+        (void)SlabFree (SLAB_SEMAPHORE, slot);
+      }
       
       #if (configQUEUE_REGISTRY_SIZE > 0)
       if (hSemaphore != NULL) {
@@ -1680,6 +2824,7 @@ osStatus_t osSemaphoreDelete (osSemaphoreId_t semaphore_id) {
 
     stat = osOK;
     vSemaphoreDelete (hSemaphore);
+    (void)SlabFree (SLAB_SEMAPHORE, hSemaphore);
   }
 #else
   stat = osError;
@@ -1689,99 +2834,241 @@ osStatus_t osSemaphoreDelete (osSemaphoreId_t semaphore_id) {
 }
 
 /*---------------------------------------------------------------------------*/
+#ifdef FREERTOS_MQUEUE_H_
+
+/* Static message queue functions */
+static MessageQueueSlot_t *MQueueSlot    (MessageQueue_t *mq, uint32_t idx);
+static uint32_t            MQueueTakeFree(MessageQueue_t *mq);
+static void                MQueueGiveFree(MessageQueue_t *mq, uint32_t idx);
+static void                MQueueLink    (MessageQueue_t *mq, uint32_t idx, uint8_t msg_prio);
+static uint32_t            MQueueUnlink  (MessageQueue_t *mq);
 
 osMessageQueueId_t osMessageQueueNew (uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr) {
-  QueueHandle_t hQueue;
-  int32_t mem;
-  #if (configQUEUE_REGISTRY_SIZE > 0)
+  MessageQueue_t *mq;
+  MessageQueueSlot_t *slot;
   const char *name;
-  #endif
+  int32_t mem_cb, mem_mq;
+  uint32_t sz, i;
 
-  hQueue = NULL;
+  if (IS_IRQ()) {
+    mq = NULL;
+  }
+  else if ((msg_count == 0U) || (msg_count >= MQUEUE_NONE) || (msg_size == 0U)) {
+    mq = NULL;
+  }
+  else {
+    mq = NULL;
+    sz = MQUEUE_ARR_SIZE (msg_count, msg_size);
 
-  if (!IS_IRQ() && (msg_count > 0U) && (msg_size > 0U)) {
-    mem = -1;
+    name = NULL;
+    mem_cb = -1;
+    mem_mq = -1;
 
     if (attr != NULL) {
-      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(StaticQueue_t)) &&
-          (attr->mq_mem != NULL) && (attr->mq_size >= (msg_count * msg_size))) {
-        mem = 1;
-      }
-      else {
-        if ((attr->cb_mem == NULL) && (attr->cb_size == 0U) &&
-            (attr->mq_mem == NULL) && (attr->mq_size == 0U)) {
-          mem = 0;
-        }
+      if (attr->name != NULL) {
+        name = attr->name;
       }
-    }
+
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(MessageQueue_t))) {
+        /* Static control block is provided */
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        /* Allocate control block memory on heap */
+        mem_cb = 0;
+      }
+
+      if ((attr->mq_mem == NULL) && (attr->mq_size == 0U)) {
+        /* Allocate message slot array on heap */
+        mem_mq = 0;
+      }
+      else {
+        if (attr->mq_mem != NULL) {
+          /* Check if array is 4-byte aligned */
+          if (((uint32_t)attr->mq_mem & 3U) == 0U) {
+            /* Check if array big enough */
+            if (attr->mq_size >= sz) {
+              /* Static message slot array is provided */
+              mem_mq = 1;
+            }
+          }
+        }
+      }
+    }
     else {
-      mem = 0;
+      /* Attributes not provided, allocate memory on heap */
+      mem_cb = 0;
+      mem_mq = 0;
     }
 
-    if (mem == 1) {
+    if ((mem_cb == 0) && (mem_mq != -1)) {
+      mq = CBAlloc (SLAB_MQUEUE, sizeof(MessageQueue_t));
+    } else if ((mem_cb == 1) && (mem_mq != -1)) {
+      mq = attr->cb_mem;
+    }
+
+    if (mq != NULL) {
+      mq->sem_msg = NULL;
+      mq->mem_arr = NULL;
+
+      /* Create slot semaphores: all slots free, no messages queued */
       #if (configSUPPORT_STATIC_ALLOCATION == 1)
-        hQueue = xQueueCreateStatic (msg_count, msg_size, attr->mq_mem, attr->cb_mem);
+        mq->sem_free = xSemaphoreCreateCountingStatic (msg_count, msg_count, &mq->mem_sem_free);
+        if (mq->sem_free != NULL) {
+          mq->sem_msg = xSemaphoreCreateCountingStatic (msg_count, 0U, &mq->mem_sem_msg);
+        }
+      #elif (configSUPPORT_DYNAMIC_ALLOCATION == 1)
+        mq->sem_free = xSemaphoreCreateCounting (msg_count, msg_count);
+        if (mq->sem_free != NULL) {
+          mq->sem_msg = xSemaphoreCreateCounting (msg_count, 0U);
+        }
+      #else
+        mq->sem_free = NULL;
       #endif
-    }
-    else {
-      if (mem == 0) {
-        #if (configSUPPORT_DYNAMIC_ALLOCATION == 1)
-          hQueue = xQueueCreate (msg_count, msg_size);
-        #endif
+
+      if (mq->sem_msg != NULL) {
+        /* Setup message slot array */
+        if (mem_mq == 0) {
+          mq->mem_arr = pvPortMalloc (sz);
+        } else {
+          mq->mem_arr = attr->mq_mem;
+        }
       }
     }
 
-    #if (configQUEUE_REGISTRY_SIZE > 0)
-    if (hQueue != NULL) {
-      if (attr != NULL) {
-        name = attr->name;
-      } else {
-        name = NULL;
+    if ((mq != NULL) && (mq->mem_arr != NULL)) {
+      /* Message queue can be created */
+      mq->name    = name;
+      mq->msg_sz  = msg_size;
+      mq->msg_cnt = msg_count;
+      mq->slot_sz = MQUEUE_SLOT_SIZE (msg_size);
+      mq->summary = 0U;
+
+      /* Chain all slots into the free list */
+      for (i = 0U; i < msg_count; i++) {
+        slot = MQueueSlot (mq, i);
+        slot->next = (uint16_t)(i + 1U);
+      }
+      MQueueSlot (mq, msg_count - 1U)->next = MQUEUE_NONE;
+      mq->free = 0U;
+
+      for (i = 0U; i < MQUEUE_PRIO_WORDS; i++) {
+        mq->map[i] = 0U;
+      }
+      for (i = 0U; i < MQUEUE_PRIO_LEVELS; i++) {
+        mq->tail[i] = MQUEUE_NONE;
+      }
+
+      #if (configQUEUE_REGISTRY_SIZE > 0)
+      vQueueAddToRegistry (mq->sem_msg, name);
+      #endif
+
+      /* Set heap allocated memory flags */
+      mq->status = MQUEUE_STATUS;
+
+      if (mem_cb == 0) {
+        /* Control block on heap */
+        mq->status |= 1U;
+      }
+      if (mem_mq == 0) {
+        /* Slot array on heap */
+        mq->status |= 2U;
       }
-      vQueueAddToRegistry (hQueue, name);
     }
-    #endif
+    else {
+      /* Message queue cannot be created, release allocated resources */
+      if (mq != NULL) {
+        if (mq->sem_msg != NULL) {
+          vSemaphoreDelete (mq->sem_msg);
+        }
+        if (mq->sem_free != NULL) {
+          vSemaphoreDelete (mq->sem_free);
+        }
+        if (mem_cb == 0) {
+          /* Free control block memory */
+          CBFree (SLAB_MQUEUE, mq);
+        }
+      }
+      mq = NULL;
+    }
+  }
+
+  return ((osMessageQueueId_t)mq);
+}
+
+const char *osMessageQueueGetName (osMessageQueueId_t mq_id) {
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
+  const char *p;
 
+  if (IS_IRQ()) {
+    p = NULL;
+  }
+  else if (mq == NULL) {
+    p = NULL;
+  }
+  else {
+    p = mq->name;
   }
 
-  return ((osMessageQueueId_t)hQueue);
+  return (p);
 }
 
 osStatus_t osMessageQueuePut (osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout) {
-  QueueHandle_t hQueue = (QueueHandle_t)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   osStatus_t stat;
   BaseType_t yield;
-
-  (void)msg_prio; /* Message priority is ignored */
+  uint32_t idx;
+  uint32_t isrm;
 
   stat = osOK;
 
-  if (IS_IRQ()) {
-    if ((hQueue == NULL) || (msg_ptr == NULL) || (timeout != 0U)) {
+  if ((mq == NULL) || (msg_ptr == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    if (timeout != 0U) {
       stat = osErrorParameter;
     }
+    else if (xSemaphoreTakeFromISR (mq->sem_free, NULL) != pdTRUE) {
+      stat = osErrorResource;
+    }
     else {
-      yield = pdFALSE;
+      /* The slot is ours once off the free list: copy without masking */
+      isrm = taskENTER_CRITICAL_FROM_ISR();
+      idx = MQueueTakeFree (mq);
+      taskEXIT_CRITICAL_FROM_ISR(isrm);
 
-      if (xQueueSendToBackFromISR (hQueue, msg_ptr, &yield) != pdTRUE) {
-        stat = osErrorResource;
-      } else {
-        portYIELD_FROM_ISR (yield);
-      }
+      memcpy (MQueueSlot (mq, idx) + 1, msg_ptr, mq->msg_sz);
+
+      isrm = taskENTER_CRITICAL_FROM_ISR();
+      MQueueLink (mq, idx, msg_prio);
+      taskEXIT_CRITICAL_FROM_ISR(isrm);
+
+      yield = pdFALSE;
+      (void)xSemaphoreGiveFromISR (mq->sem_msg, &yield);
+      portYIELD_FROM_ISR (yield);
     }
   }
   else {
-    if ((hQueue == NULL) || (msg_ptr == NULL)) {
-      stat = osErrorParameter;
+    if (xSemaphoreTake (mq->sem_free, (TickType_t)timeout) != pdPASS) {
+      if (timeout != 0U) {
+        stat = osErrorTimeout;
+      } else {
+        stat = osErrorResource;
+      }
     }
     else {
-      if (xQueueSendToBack (hQueue, msg_ptr, (TickType_t)timeout) != pdPASS) {
-        if (timeout != 0U) {
-          stat = osErrorTimeout;
-        } else {
-          stat = osErrorResource;
-        }
-      }
+      taskENTER_CRITICAL();
+      idx = MQueueTakeFree (mq);
+      taskEXIT_CRITICAL();
+
+      memcpy (MQueueSlot (mq, idx) + 1, msg_ptr, mq->msg_sz);
+
+      taskENTER_CRITICAL();
+      MQueueLink (mq, idx, msg_prio);
+      taskEXIT_CRITICAL();
+
+      (void)xSemaphoreGive (mq->sem_msg);
     }
   }
 
@@ -1789,40 +3076,69 @@ osStatus_t osMessageQueuePut (osMessageQueueId_t mq_id, const void *msg_ptr, uin
 }
 
 osStatus_t osMessageQueueGet (osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout) {
-  QueueHandle_t hQueue = (QueueHandle_t)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
+  MessageQueueSlot_t *slot;
   osStatus_t stat;
   BaseType_t yield;
-
-  (void)msg_prio; /* Message priority is ignored */
+  uint32_t idx;
+  uint32_t isrm;
 
   stat = osOK;
 
-  if (IS_IRQ()) {
-    if ((hQueue == NULL) || (msg_ptr == NULL) || (timeout != 0U)) {
+  if ((mq == NULL) || (msg_ptr == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else if (IS_IRQ()) {
+    if (timeout != 0U) {
       stat = osErrorParameter;
     }
+    else if (xSemaphoreTakeFromISR (mq->sem_msg, NULL) != pdTRUE) {
+      stat = osErrorResource;
+    }
     else {
-      yield = pdFALSE;
-
-      if (xQueueReceiveFromISR (hQueue, msg_ptr, &yield) != pdPASS) {
-        stat = osErrorResource;
-      } else {
-        portYIELD_FROM_ISR (yield);
+      isrm = taskENTER_CRITICAL_FROM_ISR();
+      idx = MQueueUnlink (mq);
+      taskEXIT_CRITICAL_FROM_ISR(isrm);
+
+      slot = MQueueSlot (mq, idx);
+      memcpy (msg_ptr, slot + 1, mq->msg_sz);
+      if (msg_prio != NULL) {
+        *msg_prio = slot->prio;
       }
+
+      isrm = taskENTER_CRITICAL_FROM_ISR();
+      MQueueGiveFree (mq, idx);
+      taskEXIT_CRITICAL_FROM_ISR(isrm);
+
+      yield = pdFALSE;
+      (void)xSemaphoreGiveFromISR (mq->sem_free, &yield);
+      portYIELD_FROM_ISR (yield);
     }
   }
   else {
-    if ((hQueue == NULL) || (msg_ptr == NULL)) {
-      stat = osErrorParameter;
+    if (xSemaphoreTake (mq->sem_msg, (TickType_t)timeout) != pdPASS) {
+      if (timeout != 0U) {
+        stat = osErrorTimeout;
+      } else {
+        stat = osErrorResource;
+      }
     }
     else {
-      if (xQueueReceive (hQueue, msg_ptr, (TickType_t)timeout) != pdPASS) {
-        if (timeout != 0U) {
-          stat = osErrorTimeout;
-        } else {
-          stat = osErrorResource;
-        }
+      taskENTER_CRITICAL();
+      idx = MQueueUnlink (mq);
+      taskEXIT_CRITICAL();
+
+      slot = MQueueSlot (mq, idx);
+      memcpy (msg_ptr, slot + 1, mq->msg_sz);
+      if (msg_prio != NULL) {
+        *msg_prio = slot->prio;
       }
+
+      taskENTER_CRITICAL();
+      MQueueGiveFree (mq, idx);
+      taskEXIT_CRITICAL();
+
+      (void)xSemaphoreGive (mq->sem_free);
     }
   }
 
@@ -1830,109 +3146,129 @@ osStatus_t osMessageQueueGet (osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *
 }
 
 uint32_t osMessageQueueGetCapacity (osMessageQueueId_t mq_id) {
-  StaticQueue_t *mq = (StaticQueue_t *)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   uint32_t capacity;
 
-  if (mq == NULL) {
+  if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     capacity = 0U;
   } else {
-    /* capacity = pxQueue->uxLength */
-    capacity = mq->uxDummy4[1];
+    capacity = mq->msg_cnt;
   }
 
   return (capacity);
 }
 
 uint32_t osMessageQueueGetMsgSize (osMessageQueueId_t mq_id) {
-  StaticQueue_t *mq = (StaticQueue_t *)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   uint32_t size;
 
-  if (mq == NULL) {
+  if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     size = 0U;
   } else {
-    /* size = pxQueue->uxItemSize */
-    size = mq->uxDummy4[2];
+    size = mq->msg_sz;
   }
 
   return (size);
 }
 
 uint32_t osMessageQueueGetCount (osMessageQueueId_t mq_id) {
-  QueueHandle_t hQueue = (QueueHandle_t)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   UBaseType_t count;
 
-  if (hQueue == NULL) {
+  if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     count = 0U;
   }
   else if (IS_IRQ()) {
-    count = uxQueueMessagesWaitingFromISR (hQueue);
+    count = uxQueueMessagesWaitingFromISR ((QueueHandle_t)mq->sem_msg);
   }
   else {
-    count = uxQueueMessagesWaiting (hQueue);
+    count = uxSemaphoreGetCount (mq->sem_msg);
   }
 
   return ((uint32_t)count);
 }
 
 uint32_t osMessageQueueGetSpace (osMessageQueueId_t mq_id) {
-  StaticQueue_t *mq = (StaticQueue_t *)mq_id;
-  uint32_t space;
-  uint32_t isrm;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
+  UBaseType_t space;
 
-  if (mq == NULL) {
+  if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     space = 0U;
   }
   else if (IS_IRQ()) {
-    isrm = taskENTER_CRITICAL_FROM_ISR();
-
-    /* space = pxQueue->uxLength - pxQueue->uxMessagesWaiting; */
-    space = mq->uxDummy4[1] - mq->uxDummy4[0];
-
-    taskEXIT_CRITICAL_FROM_ISR(isrm);
+    space = uxQueueMessagesWaitingFromISR ((QueueHandle_t)mq->sem_free);
   }
   else {
-    space = (uint32_t)uxQueueSpacesAvailable ((QueueHandle_t)mq);
+    space = uxSemaphoreGetCount (mq->sem_free);
   }
 
-  return (space);
+  return ((uint32_t)space);
 }
 
 osStatus_t osMessageQueueReset (osMessageQueueId_t mq_id) {
-  QueueHandle_t hQueue = (QueueHandle_t)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   osStatus_t stat;
+  uint32_t idx;
 
   if (IS_IRQ()) {
     stat = osErrorISR;
   }
-  else if (hQueue == NULL) {
+  else if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     stat = osErrorParameter;
   }
   else {
     stat = osOK;
-    (void)xQueueReset (hQueue);
+
+    /* Discard queued messages; each freed slot may wake a blocked sender */
+    while (xSemaphoreTake (mq->sem_msg, 0U) == pdTRUE) {
+      taskENTER_CRITICAL();
+      idx = MQueueUnlink (mq);
+      MQueueGiveFree (mq, idx);
+      taskEXIT_CRITICAL();
+
+      (void)xSemaphoreGive (mq->sem_free);
+    }
   }
 
   return (stat);
 }
 
 osStatus_t osMessageQueueDelete (osMessageQueueId_t mq_id) {
-  QueueHandle_t hQueue = (QueueHandle_t)mq_id;
+  MessageQueue_t *mq = (MessageQueue_t *)mq_id;
   osStatus_t stat;
 
 #ifndef USE_FreeRTOS_HEAP_1
   if (IS_IRQ()) {
     stat = osErrorISR;
   }
-  else if (hQueue == NULL) {
+  else if ((mq == NULL) || ((mq->status & MQUEUE_STATUS) != MQUEUE_STATUS)) {
     stat = osErrorParameter;
   }
   else {
     #if (configQUEUE_REGISTRY_SIZE > 0)
-    vQueueUnregisterQueue (hQueue);
+    vQueueUnregisterQueue (mq->sem_msg);
     #endif
 
+    taskENTER_CRITICAL();
+
+    /* Invalidate control block status */
+    mq->status = mq->status & 3U;
+
+    vSemaphoreDelete (mq->sem_msg);
+    vSemaphoreDelete (mq->sem_free);
+
+    if ((mq->status & 2U) != 0U) {
+      /* Slot array allocated on heap */
+      vPortFree (mq->mem_arr);
+    }
+    if ((mq->status & 1U) != 0U) {
+      /* Control block allocated on heap or in the slab */
+      CBFree (SLAB_MQUEUE, mq);
+    }
+
+    taskEXIT_CRITICAL();
+
     stat = osOK;
-    vQueueDelete (hQueue);
   }
 #else
   stat = osError;
@@ -1941,13 +3277,107 @@ osStatus_t osMessageQueueDelete (osMessageQueueId_t mq_id) {
   return (stat);
 }
 
+/*
+  Return the slot with the given index.
+*/
+static MessageQueueSlot_t *MQueueSlot (MessageQueue_t *mq, uint32_t idx) {
+  return ((MessageQueueSlot_t *)(mq->mem_arr + (mq->slot_sz * idx)));
+}
+
+/*
+  Take a slot off the free list. The caller holds a sem_free token, so the
+  list cannot be empty. Must be called with interrupts masked.
+*/
+static uint32_t MQueueTakeFree (MessageQueue_t *mq) {
+  uint32_t idx = mq->free;
+
+  mq->free = MQueueSlot (mq, idx)->next;
+
+  return (idx);
+}
+
+/*
+  Return a slot to the free list. Must be called with interrupts masked.
+*/
+static void MQueueGiveFree (MessageQueue_t *mq, uint32_t idx) {
+  MQueueSlot (mq, idx)->next = mq->free;
+  mq->free = (uint16_t)idx;
+}
+
+/*
+  Append a filled slot to the list of its priority. Each list is circular:
+  the tail slot links back to the head, so the head needs no index of its
+  own. Must be called with interrupts masked.
+*/
+static void MQueueLink (MessageQueue_t *mq, uint32_t idx, uint8_t msg_prio) {
+  MessageQueueSlot_t *slot = MQueueSlot (mq, idx);
+  MessageQueueSlot_t *tail;
+  uint32_t word = (uint32_t)msg_prio >> 5;
+
+  slot->prio = msg_prio;
+
+  if (mq->tail[msg_prio] == MQUEUE_NONE) {
+    slot->next = (uint16_t)idx;
+    mq->map[word] |= (1UL << (msg_prio & 31U));
+    mq->summary   |= (1UL << word);
+  } else {
+    tail = MQueueSlot (mq, mq->tail[msg_prio]);
+    slot->next = tail->next;
+    tail->next = (uint16_t)idx;
+  }
+  mq->tail[msg_prio] = (uint16_t)idx;
+}
+
+/*
+  Remove the oldest slot of the highest non-empty priority. The caller
+  holds a sem_msg token, so the map cannot be empty.
+  Must be called with interrupts masked.
+*/
+static uint32_t MQueueUnlink (MessageQueue_t *mq) {
+  MessageQueueSlot_t *tail;
+  uint32_t word = 31U - __CLZ (mq->summary);
+  uint32_t prio = (word << 5) | (31U - __CLZ (mq->map[word]));
+  uint32_t idx;
+
+  tail = MQueueSlot (mq, mq->tail[prio]);
+  idx  = tail->next;
+
+  if (idx == mq->tail[prio]) {
+    /* Last message of this priority */
+    mq->tail[prio] = MQUEUE_NONE;
+    mq->map[word] &= ~(1UL << (prio & 31U));
+    if (mq->map[word] == 0U) {
+      mq->summary &= ~(1UL << word);
+    }
+  } else {
+    tail->next = MQueueSlot (mq, idx)->next;
+  }
+
+  return (idx);
+}
+#endif /* FREERTOS_MQUEUE_H_ */
+
 /*---------------------------------------------------------------------------*/
 #ifdef FREERTOS_MPOOL_H_
 
 /* Static memory pool functions */
-static void  FreeBlock   (MemPool_t *mp, void *block);
-static void *AllocBlock  (MemPool_t *mp);
-static void *CreateBlock (MemPool_t *mp);
+static void    *MemPoolAlloc (MemPool_t *mp, uint32_t timeout, uint32_t zero);
+static void     FreeBlock   (MemPool_t *mp, volatile uint32_t *list, void *block);
+static void    *AllocBlock  (MemPool_t *mp, volatile uint32_t *list);
+static void    *CreateBlock (MemPool_t *mp);
+static void    *TryAlloc    (MemPool_t *mp, uint32_t zero);
+static void     ZeroBlock   (void *block, uint32_t size);
+static uint32_t AtomicCAS   (volatile uint32_t *mem, uint32_t expected, uint32_t desired);
+static uint32_t AtomicInc   (volatile uint32_t *mem, uint32_t limit);
+static uint32_t AtomicDec   (volatile uint32_t *mem);
+
+#if (configOS2_MPOOL_PREZERO == 1)
+/* Bytes zeroed by osMemoryPoolZeroIdle per critical section */
+#define MPOOL_ZERO_CHUNK          64U
+
+static MemPool_t *MemPoolZeroList;      /* Pools zeroed by the idle task     */
+static MemPool_t *MemPoolZeroBusy;      /* Pool whose block is being zeroed  */
+#endif
 
 osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, const osMemoryPoolAttr_t *attr) {
   MemPool_t *mp;
@@ -1958,7 +3388,7 @@ osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, con
   if (IS_IRQ()) {
     mp = NULL;
   }
-  else if ((block_count == 0U) || (block_size == 0U)) {
+  else if ((block_count == 0U) || (block_count >= MPOOL_NONE) || (block_size == 0U)) {
     mp = NULL;
   }
   else {
@@ -2007,17 +3437,18 @@ osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, con
     }
 
     if (mem_cb == 0) {
-      mp = pvPortMalloc (sizeof(MemPool_t));
+      mp = CBAlloc (SLAB_MPOOL, sizeof(MemPool_t));
     } else {
       mp = attr->cb_mem;
     }
 
     if (mp != NULL) {
-      /* Create a semaphore (max count == initial count == block_count) */
+      /* Create a semaphore to wake blocked allocations (initial count == 0).
+         Free blocks are tracked by the lock-free free list */
       #if (configSUPPORT_STATIC_ALLOCATION == 1)
-        mp->sem = xSemaphoreCreateCountingStatic (block_count, block_count, &mp->mem_sem);
+        mp->sem = xSemaphoreCreateCountingStatic (block_count, 0U, &mp->mem_sem);
       #elif (configSUPPORT_DYNAMIC_ALLOCATION == 1)
-        mp->sem = xSemaphoreCreateCounting (block_count, block_count);
+        mp->sem = xSemaphoreCreateCounting (block_count, 0U);
       #else
         mp->sem == NULL;
       #endif
@@ -2034,12 +3465,15 @@ osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, con
 
     if ((mp != NULL) && (mp->mem_arr != NULL)) {
       /* Memory pool can be created */
-      mp->head    = NULL;
+      mp->head    = MPOOL_NONE;
+      mp->clean   = MPOOL_NONE;
       mp->mem_sz  = sz;
       mp->name    = name;
       mp->bl_sz   = block_size;
       mp->bl_cnt  = block_count;
       mp->n       = 0U;
+      mp->used    = 0U;
+      mp->waiters = 0U;
 
       /* Set heap allocated memory flags */
       mp->status = MPOOL_STATUS;
@@ -2052,12 +3486,20 @@ osMemoryPoolId_t osMemoryPoolNew (uint32_t block_count, uint32_t block_size, con
         /* Memory array on heap */
         mp->status |= 2U;
       }
+
+      #if (configOS2_MPOOL_PREZERO == 1)
+      /* Have the idle task zero freed blocks */
+      taskENTER_CRITICAL();
+      mp->next = MemPoolZeroList;
+      MemPoolZeroList = mp;
+      taskEXIT_CRITICAL();
+      #endif
     }
     else {
       /* Memory pool cannot be created, release allocated resources */
       if ((mem_cb == 0) && (mp != NULL)) {
         /* Free control block memory */
-        vPortFree (mp);
+        CBFree (SLAB_MPOOL, mp);
       }
       mp = NULL;
     }
@@ -2084,55 +3526,66 @@ const char *osMemoryPoolGetName (osMemoryPoolId_t mp_id) {
 }
 
 void *osMemoryPoolAlloc (osMemoryPoolId_t mp_id, uint32_t timeout) {
-  MemPool_t *mp;
+  return (MemPoolAlloc ((MemPool_t *)mp_id, timeout, 0U));
+}
+
+void *osMemoryPoolCAlloc (osMemoryPoolId_t mp_id, uint32_t timeout) {
+  return (MemPoolAlloc ((MemPool_t *)mp_id, timeout, 1U));
+}
+
+/*
+  Allocate a block, waiting up to 'timeout' ticks for one to be freed.
+  Zero it if 'zero' is not 0.
+*/
+static void *MemPoolAlloc (MemPool_t *mp, uint32_t timeout, uint32_t zero) {
   void *block;
-  uint32_t isrm;
+  TimeOut_t tmo;
+  TickType_t ticks;
 
-  if (mp_id == NULL) {
+  if (mp == NULL) {
     /* Invalid input parameters */
     block = NULL;
   }
+  else if (IS_IRQ() && (timeout != 0U)) {
+    /* Interrupts cannot block */
+    block = NULL;
+  }
   else {
     block = NULL;
 
-    mp = (MemPool_t *)mp_id;
-
     if ((mp->status & MPOOL_STATUS) == MPOOL_STATUS) {
-      if (IS_IRQ()) {
-        if (timeout == 0U) {
-          if (xSemaphoreTakeFromISR (mp->sem, NULL) == pdTRUE) {
-            if ((mp->status & MPOOL_STATUS) == MPOOL_STATUS) {
-              isrm  = taskENTER_CRITICAL_FROM_ISR();
-
-              /* Get a block from the free-list */
-              block = AllocBlock(mp);
-
-              if (block == NULL) {
-                /* List of free blocks is empty, 'create' new block */
-                block = CreateBlock(mp);
-              }
-
-              taskEXIT_CRITICAL_FROM_ISR(isrm);
-            }
+      /* Take a block without entering the kernel or masking interrupts */
+      block = TryAlloc(mp, zero);
+
+      if ((block == NULL) && (timeout != 0U)) {
+        /* Pool is empty: register as a waiter and retry. A block freed once
+           the waiter count is raised always gives the semaphore, so a block
+           freed between the two attempts cannot be missed. */
+        ticks = (TickType_t)timeout;
+        vTaskSetTimeOutState (&tmo);
+        (void)AtomicInc (&mp->waiters, UINT32_MAX);
+
+        block = TryAlloc(mp, zero);
+
+        while (block == NULL) {
+          if (xSemaphoreTake (mp->sem, ticks) != pdTRUE) {
+            /* Timeout expired */
+            break;
+          }
+          if ((mp->status & MPOOL_STATUS) != MPOOL_STATUS) {
+            /* Memory pool deleted */
+            break;
           }
-        }
-      }
-      else {
-        if (xSemaphoreTake (mp->sem, (TickType_t)timeout) == pdTRUE) {
-          if ((mp->status & MPOOL_STATUS) == MPOOL_STATUS) {
-            taskENTER_CRITICAL();
-
-            /* Get a block from the free-list */
-            block = AllocBlock(mp);
 
-            if (block == NULL) {
-              /* List of free blocks is empty, 'create' new block */
-              block = CreateBlock(mp);
-            }
+          block = TryAlloc(mp, zero);
 
-            taskEXIT_CRITICAL();
+          if ((block == NULL) && (xTaskCheckForTimeOut (&tmo, &ticks) != pdFALSE)) {
+            /* Another thread took the block, and the timeout expired */
+            break;
           }
         }
+
+        (void)AtomicDec (&mp->waiters);
       }
     }
   }
@@ -2143,7 +3596,6 @@ void *osMemoryPoolAlloc (osMemoryPoolId_t mp_id, uint32_t timeout) {
 osStatus_t osMemoryPoolFree (osMemoryPoolId_t mp_id, void *block) {
   MemPool_t *mp;
   osStatus_t stat;
-  uint32_t isrm;
   BaseType_t yield;
 
   if ((mp_id == NULL) || (block == NULL)) {
@@ -2161,39 +3613,28 @@ osStatus_t osMemoryPoolFree (osMemoryPoolId_t mp_id, void *block) {
       /* Block pointer outside of memory array area */
       stat = osErrorParameter;
     }
+    else if ((((uint8_t *)block - mp->mem_arr) % MEMPOOL_BLOCK_STRIDE(mp->bl_sz)) != 0U) {
+      /* Block pointer not at the start of a block */
+      stat = osErrorParameter;
+    }
+    else if (AtomicDec (&mp->used) == 0U) {
+      /* No blocks are allocated */
+      stat = osErrorResource;
+    }
     else {
       stat = osOK;
 
-      if (IS_IRQ()) {
-        if (uxSemaphoreGetCountFromISR (mp->sem) == mp->bl_cnt) {
-          stat = osErrorResource;
-        }
-        else {
-          isrm = taskENTER_CRITICAL_FROM_ISR();
-
-          /* Add block to the list of free blocks */
-          FreeBlock(mp, block);
-
-          taskEXIT_CRITICAL_FROM_ISR(isrm);
+      /* Add block to the list of free blocks */
+      FreeBlock(mp, &mp->head, block);
 
+      if (mp->waiters != 0U) {
+        /* Wake-up a thread blocked in osMemoryPoolAlloc */
+        if (IS_IRQ()) {
           yield = pdFALSE;
-          xSemaphoreGiveFromISR (mp->sem, &yield);
+          (void)xSemaphoreGiveFromISR (mp->sem, &yield);
           portYIELD_FROM_ISR (yield);
-        }
-      }
-      else {
-        if (uxSemaphoreGetCount (mp->sem) == mp->bl_cnt) {
-          stat = osErrorResource;
-        }
-        else {
-          taskENTER_CRITICAL();
-
-          /* Add block to the list of free blocks */
-          FreeBlock(mp, block);
-
-          taskEXIT_CRITICAL();
-
-          xSemaphoreGive (mp->sem);
+        } else {
+          (void)xSemaphoreGive (mp->sem);
         }
       }
     }
@@ -2266,13 +3707,7 @@ uint32_t osMemoryPoolGetCount (osMemoryPoolId_t mp_id) {
       n = 0U;
     }
     else {
-      if (IS_IRQ()) {
-        n = uxSemaphoreGetCountFromISR (mp->sem);
-      } else {
-        n = uxSemaphoreGetCount        (mp->sem);
-      }
-
-      n = mp->bl_cnt - n;
+      n = mp->used;
     }
   }
 
@@ -2296,11 +3731,7 @@ uint32_t osMemoryPoolGetSpace (osMemoryPoolId_t mp_id) {
       n = 0U;
     }
     else {
-      if (IS_IRQ()) {
-        n = uxSemaphoreGetCountFromISR (mp->sem);
-      } else {
-        n = uxSemaphoreGetCount        (mp->sem);
-      }
+      n = mp->bl_cnt - mp->used;
     }
   }
 
@@ -2330,17 +3761,35 @@ osStatus_t osMemoryPoolDelete (osMemoryPoolId_t mp_id) {
     /* Wake-up tasks waiting for pool semaphore */
     while (xSemaphoreGive (mp->sem) == pdTRUE);
 
-    mp->head    = NULL;
+    mp->head    = MPOOL_NONE;
+    mp->clean   = MPOOL_NONE;
     mp->bl_sz   = 0U;
     mp->bl_cnt  = 0U;
 
+    #if (configOS2_MPOOL_PREZERO == 1)
+    {
+      MemPool_t **link;
+
+      /* Stop the idle task zeroing blocks of this pool */
+      for (link = &MemPoolZeroList; *link != NULL; link = &(*link)->next) {
+        if (*link == mp) {
+          *link = mp->next;
+          break;
+        }
+      }
+      if (MemPoolZeroBusy == mp) {
+        MemPoolZeroBusy = NULL;
+      }
+    }
+    #endif
+
     if ((mp->status & 2U) != 0U) {
       /* Memory pool array allocated on heap */
       vPortFree (mp->mem_arr);
     }
     if ((mp->status & 1U) != 0U) {
-      /* Memory pool control block allocated on heap */
-      vPortFree (mp);
+      /* Memory pool control block allocated on heap or in the slab */
+      CBFree (SLAB_MPOOL, mp);
     }
 
     taskEXIT_CRITICAL();
@@ -2351,54 +3800,481 @@ osStatus_t osMemoryPoolDelete (osMemoryPoolId_t mp_id) {
   return (stat);
 }
 
+void osMemoryPoolZeroIdle (void) {
+#if (configOS2_MPOOL_PREZERO == 1)
+  MemPool_t *mp;
+  uint8_t *block;
+  uint32_t size, done, n;
+
+  /* Take a freed block out of the first pool that has one */
+  block = NULL;
+  size  = 0U;
+
+  taskENTER_CRITICAL();
+  for (mp = MemPoolZeroList; mp != NULL; mp = mp->next) {
+    block = AllocBlock (mp, &mp->head);
+    if (block != NULL) {
+      size = MEMPOOL_BLOCK_STRIDE(mp->bl_sz);
+      break;
+    }
+  }
+  MemPoolZeroBusy = mp;
+  taskEXIT_CRITICAL();
+
+  /* Zero it a chunk at a time. osMemoryPoolDelete clears MemPoolZeroBusy,
+     so no chunk is written once the pool has been deleted. */
+  for (done = 0U; done < size; done += n) {
+    n = ((size - done) < MPOOL_ZERO_CHUNK) ? (size - done) : MPOOL_ZERO_CHUNK;
+
+    taskENTER_CRITICAL();
+    if (MemPoolZeroBusy == mp) {
+      ZeroBlock (block + done, n);
+    } else {
+      size = 0U;
+    }
+    taskEXIT_CRITICAL();
+  }
+
+  if (mp != NULL) {
+    taskENTER_CRITICAL();
+    if (MemPoolZeroBusy == mp) {
+      /* Hand the block back as a clean one */
+      FreeBlock (mp, &mp->clean, block);
+      MemPoolZeroBusy = NULL;
+
+      if (mp->waiters != 0U) {
+        /* A thread may have found the pool empty while the block was out */
+        (void)xSemaphoreGive (mp->sem);
+      }
+    }
+    taskEXIT_CRITICAL();
+  }
+#endif
+}
+
+/*
+  Allocate a block from the free lists, or create a new one. Zero it if
+  'zero' is not 0: a block from the clean list only needs its link cleared.
+*/
+static void *TryAlloc (MemPool_t *mp, uint32_t zero) {
+  void *block;
+  uint32_t clean;
+
+  block = NULL;
+  clean = 0U;
+
+#if (configOS2_MPOOL_PREZERO == 1)
+  if (zero != 0U) {
+    /* Prefer a block the idle task has zeroed */
+    block = AllocBlock(mp, &mp->clean);
+    clean = (block != NULL) ? 1U : 0U;
+  }
+#endif
+
+  if (block == NULL) {
+    /* Get a block from the free-list */
+    block = AllocBlock(mp, &mp->head);
+  }
+
+  if (block == NULL) {
+    /* List of free blocks is empty, 'create' new block */
+    block = CreateBlock(mp);
+  }
+
+#if (configOS2_MPOOL_PREZERO == 1)
+  if ((block == NULL) && (zero == 0U)) {
+    /* Only zeroed blocks are left */
+    block = AllocBlock(mp, &mp->clean);
+  }
+#endif
+
+  if (block != NULL) {
+    (void)AtomicInc (&mp->used, mp->bl_cnt);
+
+    if (clean != 0U) {
+      /* Only the free list link was written since the block was zeroed */
+      ((MemPoolBlock_t *)block)->next = 0U;
+    }
+    else if (zero != 0U) {
+      ZeroBlock (block, MEMPOOL_BLOCK_STRIDE(mp->bl_sz));
+    }
+  }
+
+  return (block);
+}
+
+/*
+  Zero a block with word stores, four words per step. Blocks are word
+  aligned and their stride is a multiple of 4 bytes.
+*/
+static void ZeroBlock (void *block, uint32_t size) {
+  uint32_t *p = block;
+  uint32_t n  = size / 4U;
+
+  for (; n >= 4U; n -= 4U) {
+    p[0] = 0U;
+    p[1] = 0U;
+    p[2] = 0U;
+    p[3] = 0U;
+    p += 4;
+  }
+
+  for (; n > 0U; n--) {
+    *p++ = 0U;
+  }
+}
+
 /*
   Create new block given according to the current block index.
 */
 static void *CreateBlock (MemPool_t *mp) {
   MemPoolBlock_t *p = NULL;
+  uint32_t n;
 
-  if (mp->n < mp->bl_cnt) {
-    /* Unallocated blocks exist, set pointer to new block */
-    p = (void *)(mp->mem_arr + (mp->bl_sz * mp->n));
+  /* Claim the next unallocated block, if any */
+  n = AtomicInc (&mp->n, mp->bl_cnt);
 
-    /* Increment block index */
-    mp->n += 1U;
+  if (n < mp->bl_cnt) {
+    /* Unallocated blocks exist, set pointer to new block */
+    p = (void *)(mp->mem_arr + (MEMPOOL_BLOCK_STRIDE(mp->bl_sz) * n));
   }
 
   return (p);
 }
 
 /*
-  Allocate a block by reading the list of free blocks.
+  Allocate a block by reading a list of free blocks.
 */
-static void *AllocBlock (MemPool_t *mp) {
-  MemPoolBlock_t *p = NULL;
+static void *AllocBlock (MemPool_t *mp, volatile uint32_t *list) {
+  MemPoolBlock_t *p;
+  uint32_t head, next;
+
+  do {
+    p    = NULL;
+    next = MPOOL_NONE;
+    head = *list;
+
+    if (MPOOL_HEAD_INDEX(head) != MPOOL_NONE) {
+      /* List of free block exists, get head block */
+      p = (void *)(mp->mem_arr + (MEMPOOL_BLOCK_STRIDE(mp->bl_sz) * MPOOL_HEAD_INDEX(head)));
+
+      /* Head block is now next on the list. If the block was taken since
+         the head was read, 'next' is stale but the tag makes the swap fail */
+      next = ((head + MPOOL_HEAD_TAG_INC) & ~0xFFFFU) | MPOOL_HEAD_INDEX(p->next);
+    }
+  } while ((p != NULL) && (AtomicCAS (list, head, next) == 0U));
+
+  return (p);
+}
 
-  if (mp->head != NULL) {
-    /* List of free block exists, get head block */
-    p = mp->head;
+/*
+  Free block by putting it to a list of free blocks.
+*/
+static void FreeBlock (MemPool_t *mp, volatile uint32_t *list, void *block) {
+  MemPoolBlock_t *p = block;
+  uint32_t head, idx;
+
+  idx = (uint32_t)((uint8_t *)block - mp->mem_arr) / MEMPOOL_BLOCK_STRIDE(mp->bl_sz);
 
-    /* Head block is now next on the list */
-    mp->head = p->next;
+  do {
+    /* Store current head into block memory space */
+    head    = *list;
+    p->next = MPOOL_HEAD_INDEX(head);
+
+    /* Store current block as new head */
+  } while (AtomicCAS (list, head, ((head + MPOOL_HEAD_TAG_INC) & ~0xFFFFU) | idx) == 0U);
+}
+
+/*
+  Store 'desired' to '*mem' if it holds 'expected'. Return 1 on success.
+*/
+static uint32_t AtomicCAS (volatile uint32_t *mem, uint32_t expected, uint32_t desired) {
+  uint32_t ok;
+
+#if ((__ARM_ARCH_7M__      == 1U) || \
+     (__ARM_ARCH_7EM__     == 1U) || \
+     (__ARM_ARCH_8M_MAIN__ == 1U))
+  /* Order earlier stores (a freed block's link) before the swap */
+  __DMB();
+
+  do {
+    ok = 1U;
+
+    if (__LDREXW (mem) != expected) {
+      __CLREX();
+      ok = 0U;
+    }
+  } while ((ok != 0U) && (__STREXW (desired, mem) != 0U));
+
+  __DMB();
+#else
+  uint32_t primask = __get_PRIMASK();
+
+  /* No exclusive access instructions: mask interrupts instead */
+  __disable_irq();
+
+  ok = 0U;
+  if (*mem == expected) {
+    *mem = desired;
+    ok = 1U;
   }
 
-  return (p);
+  __set_PRIMASK (primask);
+#endif
+
+  return (ok);
 }
 
 /*
-  Free block by putting it to the list of free blocks.
+  Increment '*mem' unless it has reached 'limit'. Return the previous value.
 */
-static void FreeBlock (MemPool_t *mp, void *block) {
-  MemPoolBlock_t *p = block;
+static uint32_t AtomicInc (volatile uint32_t *mem, uint32_t limit) {
+  uint32_t val;
 
-  /* Store current head into block memory space */
-  p->next = mp->head;
+  do {
+    val = *mem;
+  } while ((val < limit) && (AtomicCAS (mem, val, val + 1U) == 0U));
 
-  /* Store current block as new head */
-  mp->head = p;
+  return (val);
+}
+
+/*
+  Decrement '*mem' unless it is zero. Return the previous value.
+*/
+static uint32_t AtomicDec (volatile uint32_t *mem) {
+  uint32_t val;
+
+  do {
+    val = *mem;
+  } while ((val != 0U) && (AtomicCAS (mem, val, val - 1U) == 0U));
+
+  return (val);
 }
 #endif /* FREERTOS_MPOOL_H_ */
 /*---------------------------------------------------------------------------*/
+#ifdef FREERTOS_MAILQ_H_
+
+osMailQueueId_t osMailQueueNew (uint32_t mail_count, uint32_t mail_size, const osMailQueueAttr_t *attr) {
+  MailQueue_t *mq;
+  osMemoryPoolAttr_t mp_attr;
+  osMessageQueueAttr_t mq_attr;
+  osMemoryPoolId_t mp_id;
+  osMessageQueueId_t mq_id;
+  int32_t mem_cb;
+
+  if (IS_IRQ()) {
+    mq = NULL;
+  }
+  else if ((mail_count == 0U) || (mail_size == 0U)) {
+    mq = NULL;
+  }
+  else {
+    mq = NULL;
+    mem_cb = -1;
+
+    (void)memset (&mp_attr, 0, sizeof(mp_attr));
+    (void)memset (&mq_attr, 0, sizeof(mq_attr));
+
+    if (attr != NULL) {
+      if ((attr->cb_mem != NULL) && (attr->cb_size >= sizeof(MailQueue_t))) {
+        /* Static control block is provided */
+        mem_cb = 1;
+      }
+      else if ((attr->cb_mem == NULL) && (attr->cb_size == 0U)) {
+        /* Allocate control block memory on heap */
+        mem_cb = 0;
+      }
+
+      /* Pool and queue storage are checked by the objects themselves */
+      mp_attr.name    = attr->name;
+      mp_attr.mp_mem  = attr->mp_mem;
+      mp_attr.mp_size = attr->mp_size;
+      mq_attr.name    = attr->name;
+      mq_attr.mq_mem  = attr->mq_mem;
+      mq_attr.mq_size = attr->mq_size;
+    }
+    else {
+      /* Attributes not provided, allocate memory on heap */
+      mem_cb = 0;
+    }
+
+    if (mem_cb == 0) {
+      mq = CBAlloc (SLAB_MAILQ, sizeof(MailQueue_t));
+    } else if (mem_cb == 1) {
+      mq = attr->cb_mem;
+    }
+
+    if (mq != NULL) {
+      /* Pool and pointer queue live inside the mail queue control block */
+      mp_attr.cb_mem  = &mq->mp;
+      mp_attr.cb_size = sizeof(mq->mp);
+      mq_attr.cb_mem  = &mq->mq;
+      mq_attr.cb_size = sizeof(mq->mq);
+
+      mp_id = osMemoryPoolNew (mail_count, mail_size, &mp_attr);
+      mq_id = NULL;
+
+      if (mp_id != NULL) {
+        mq_id = osMessageQueueNew (mail_count, sizeof(void *), &mq_attr);
+      }
+
+      if (mq_id != NULL) {
+        /* Mail queue can be created */
+        mq->status = MAILQ_STATUS;
+
+        if (mem_cb == 0) {
+          /* Control block on heap */
+          mq->status |= 1U;
+        }
+      }
+      else {
+        /* Mail queue cannot be created, release allocated resources */
+        if (mp_id != NULL) {
+          (void)osMemoryPoolDelete (mp_id);
+        }
+        if (mem_cb == 0) {
+          /* Free control block memory */
+          CBFree (SLAB_MAILQ, mq);
+        }
+        mq = NULL;
+      }
+    }
+  }
+
+  return ((osMailQueueId_t)mq);
+}
+
+void *osMailQueueAlloc (osMailQueueId_t mq_id, uint32_t timeout) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  void *mail;
+
+  if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    mail = NULL;
+  } else {
+    mail = osMemoryPoolAlloc (&mq->mp, timeout);
+  }
+
+  return (mail);
+}
+
+void *osMailQueueCAlloc (osMailQueueId_t mq_id, uint32_t timeout) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  void *mail;
+
+  if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    mail = NULL;
+  } else {
+    mail = osMemoryPoolCAlloc (&mq->mp, timeout);
+  }
+
+  return (mail);
+}
+
+osStatus_t osMailQueuePut (osMailQueueId_t mq_id, void *mail, uint8_t msg_prio) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  osStatus_t stat;
+
+  if ((mq == NULL) || (mail == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* The queue has a slot for every pool block, so it cannot be full */
+    stat = osMessageQueuePut (&mq->mq, &mail, msg_prio, 0U);
+  }
+
+  return (stat);
+}
+
+osStatus_t osMailQueueGet (osMailQueueId_t mq_id, void **mail, uint8_t *msg_prio, uint32_t timeout) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  osStatus_t stat;
+
+  if ((mq == NULL) || (mail == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    stat = osMessageQueueGet (&mq->mq, mail, msg_prio, timeout);
+
+    if (stat != osOK) {
+      *mail = NULL;
+    }
+  }
+
+  return (stat);
+}
+
+osStatus_t osMailQueueFree (osMailQueueId_t mq_id, void *mail) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  osStatus_t stat;
+
+  if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    stat = osErrorParameter;
+  } else {
+    stat = osMemoryPoolFree (&mq->mp, mail);
+  }
+
+  return (stat);
+}
+
+uint32_t osMailQueueGetCount (osMailQueueId_t mq_id) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  uint32_t count;
+
+  if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    count = 0U;
+  } else {
+    count = osMessageQueueGetCount (&mq->mq);
+  }
+
+  return (count);
+}
+
+uint32_t osMailQueueGetMailSize (osMailQueueId_t mq_id) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  uint32_t sz;
+
+  if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    sz = 0U;
+  } else {
+    sz = osMemoryPoolGetBlockSize (&mq->mp);
+  }
+
+  return (sz);
+}
+
+osStatus_t osMailQueueDelete (osMailQueueId_t mq_id) {
+  MailQueue_t *mq = (MailQueue_t *)mq_id;
+  osStatus_t stat;
+
+#ifndef USE_FreeRTOS_HEAP_1
+  if (IS_IRQ()) {
+    stat = osErrorISR;
+  }
+  else if ((mq == NULL) || ((mq->status & MAILQ_STATUS) != MAILQ_STATUS)) {
+    stat = osErrorParameter;
+  }
+  else {
+    /* Invalidate control block status */
+    mq->status = mq->status & 1U;
+
+    (void)osMessageQueueDelete (&mq->mq);
+    (void)osMemoryPoolDelete (&mq->mp);
+
+    if ((mq->status & 1U) != 0U) {
+      /* Control block allocated on heap or in the slab */
+      CBFree (SLAB_MAILQ, mq);
+    }
+
+    stat = osOK;
+  }
+#else
+  stat = osError;
+#endif
+
+  return (stat);
+}
+#endif /* FREERTOS_MAILQ_H_ */
+/*---------------------------------------------------------------------------*/
 
 /* Callback function prototypes */
 extern void vApplicationIdleHook (void);
@@ -2408,10 +4284,15 @@ extern void vApplicationDaemonTaskStartupHook (void);
 extern void vApplicationStackOverflowHook (TaskHandle_t xTask, signed char *pcTaskName);
 
 /**
-  Dummy implementation of the callback function vApplicationIdleHook().
+  Default implementation of the callback function vApplicationIdleHook().
+  Zeroes freed memory pool blocks when configOS2_MPOOL_PREZERO is 1.
 */
 #if (configUSE_IDLE_HOOK == 1)
-__WEAK void vApplicationIdleHook (void){}
+__WEAK void vApplicationIdleHook (void){
+#if (configOS2_MPOOL_PREZERO == 1)
+  osMemoryPoolZeroIdle();
+#endif
+}
 #endif
 
 /**
@@ -206,6 +206,9 @@ typedef void *osMemoryPoolId_t;
 /// \details Message Queue ID identifies the message queue.
 typedef void *osMessageQueueId_t;
 
+/// \details Mail Queue ID identifies the mail queue (extension).
+typedef void *osMailQueueId_t;
+
 
 #ifndef TZ_MODULEID_T
 #define TZ_MODULEID_T
@@ -279,6 +282,33 @@ typedef struct {
   uint32_t                   mq_size;   ///< size of provided memory for data storage
 } osMessageQueueAttr_t;
 
+/// Attributes structure for mail queue (extension).
+typedef struct {
+  const char                   *name;   ///< name of the mail queue
+  uint32_t                 attr_bits;   ///< attribute bits
+  void                      *cb_mem;    ///< memory for control block
+  uint32_t                   cb_size;   ///< size of provided memory for control block
+  void                      *mp_mem;    ///< memory for mail storage
+  uint32_t                   mp_size;   ///< size of provided memory for mail storage
+  void                      *mq_mem;    ///< memory for queued mail pointers
+  uint32_t                   mq_size;   ///< size of provided memory for queued mail pointers
+} osMailQueueAttr_t;
+
+/// Thread flags wake-up counters (extension).
+typedef struct {
+  uint32_t                   wakeups;   ///< waiting threads woken with their wait condition met
+  uint32_t                  spurious;   ///< waiting threads woken with their wait condition not met
+  uint32_t                  deferred;   ///< flags set on a waiting thread without waking it
+} osThreadFlagsStats_t;
+
+/// Tickless idle counters (extension).
+typedef struct {
+  uint32_t                    sleeps;   ///< times the kernel slept through idle ticks, one wake-up each
+  uint32_t                     early;   ///< sleeps ended by an interrupt before the next thread was due
+  uint32_t                   aborted;   ///< sleeps abandoned because a thread became ready
+  uint64_t                sleep_time;   ///< system timer counts spent asleep
+} osKernelIdleStats_t;
+
 
 //  ==== Kernel Management Functions ====
 
@@ -338,6 +368,24 @@ uint32_t osKernelGetSysTimerCount (void);
 /// \return frequency of the system timer in hertz, i.e. timer ticks per second.
 uint32_t osKernelGetSysTimerFreq (void);
 
+/// Get the RTOS kernel system timer count as a 64-bit value (extension).
+/// \return RTOS kernel current system timer count as 64-bit value.
+uint64_t osKernelGetSysTimerCount64 (void);
+
+/// Convert a system timer count to nanoseconds (extension).
+/// \param[in]     count         system timer count or interval.
+/// \return the time in nanoseconds.
+uint64_t osKernelSysTimerToNs (uint64_t count);
+
+/// Convert nanoseconds to a system timer count (extension).
+/// \param[in]     ns            time in nanoseconds.
+/// \return the system timer count, rounded down.
+uint64_t osKernelNsToSysTimer (uint64_t ns);
+
+/// Get the tickless idle counters (extension).
+/// \param[out]    stats         pointer to structure receiving the counters.
+void osKernelGetIdleStats (osKernelIdleStats_t *stats);
+
 
 //  ==== Thread Management Functions ====
 
@@ -425,6 +473,13 @@ uint32_t osThreadGetCount (void);
 /// \return number of enumerated threads.
 uint32_t osThreadEnumerate (osThreadId_t *thread_array, uint32_t array_items);
 
+/// Enumerate active threads in chunks, without allocating memory (extension).
+/// \param[in,out] cursor        enumeration position: set to 0 before the first call.
+/// \param[out]    thread_array  pointer to array for retrieving thread IDs.
+/// \param[in]     array_items   maximum number of items in array for retrieving thread IDs.
+/// \return number of enumerated threads, 0 when enumeration is complete.
+uint32_t osThreadEnumerateNext (uint32_t *cursor, osThreadId_t *thread_array, uint32_t array_items);
+
 
 //  ==== Thread Flags Functions ====
 
@@ -450,6 +505,10 @@ uint32_t osThreadFlagsGet (void);
 /// \return thread flags before clearing or error code if highest bit set.
 uint32_t osThreadFlagsWait (uint32_t flags, uint32_t options, uint32_t timeout);
 
+/// Get the thread flags wake-up counters (extension).
+/// \param[out]    stats         pointer to structure receiving the counters.
+void osThreadFlagsGetStats (osThreadFlagsStats_t *stats);
+
 
 //  ==== Generic Wait Functions ====
 
@@ -634,6 +693,12 @@ const char *osMemoryPoolGetName (osMemoryPoolId_t mp_id);
 /// \return address of the allocated memory block or NULL in case of no memory is available.
 void *osMemoryPoolAlloc (osMemoryPoolId_t mp_id, uint32_t timeout);
 
+/// Allocate a memory block from a Memory Pool and set it to zero (extension).
+/// \param[in]     mp_id         memory pool ID obtained by \ref osMemoryPoolNew.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return address of the allocated memory block or NULL in case of no memory is available.
+void *osMemoryPoolCAlloc (osMemoryPoolId_t mp_id, uint32_t timeout);
+
 /// Return an allocated memory block back to a Memory Pool.
 /// \param[in]     mp_id         memory pool ID obtained by \ref osMemoryPoolNew.
 /// \param[in]     block         address of the allocated memory block to be returned to the memory pool.
@@ -665,6 +730,12 @@ uint32_t osMemoryPoolGetSpace (osMemoryPoolId_t mp_id);
 /// \return status code that indicates the execution status of the function.
 osStatus_t osMemoryPoolDelete (osMemoryPoolId_t mp_id);
 
+/// Zero one freed memory block, so that \ref osMemoryPoolCAlloc can hand it out
+/// without clearing it (extension). The wrapper's default idle hook calls it;
+/// an application that defines vApplicationIdleHook must call it from there.
+/// Does nothing unless configOS2_MPOOL_PREZERO is 1.
+void osMemoryPoolZeroIdle (void);
+
 
 //  ==== Message Queue Management Functions ====
 
@@ -727,6 +798,66 @@ osStatus_t osMessageQueueReset (osMessageQueueId_t mq_id);
 osStatus_t osMessageQueueDelete (osMessageQueueId_t mq_id);
 
 
+//  ==== Mail Queue Management Functions (extension) ====
+//  A mail queue pairs a memory pool with a queue of block pointers, so mail
+//  is filled in place by the sender and read in place by the receiver.
+
+/// Create and Initialize a Mail Queue object.
+/// \param[in]     mail_count    maximum number of mails in queue.
+/// \param[in]     mail_size     mail size in bytes.
+/// \param[in]     attr          mail queue attributes; NULL: default values.
+/// \return mail queue ID for reference by other functions or NULL in case of error.
+osMailQueueId_t osMailQueueNew (uint32_t mail_count, uint32_t mail_size, const osMailQueueAttr_t *attr);
+
+/// Allocate a mail to fill in, or timeout if none is free.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return pointer to the allocated mail or NULL in case of error.
+void *osMailQueueAlloc (osMailQueueId_t mq_id, uint32_t timeout);
+
+/// Allocate a mail set to zero, or timeout if none is free (extension).
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return pointer to the allocated mail or NULL in case of error.
+void *osMailQueueCAlloc (osMailQueueId_t mq_id, uint32_t timeout);
+
+/// Put an allocated mail into a Mail Queue. Never blocks.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \param[in]     mail          mail obtained by \ref osMailQueueAlloc.
+/// \param[in]     msg_prio      mail priority.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osMailQueuePut (osMailQueueId_t mq_id, void *mail, uint8_t msg_prio);
+
+/// Get a mail from a Mail Queue or timeout if Queue is empty.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \param[out]    mail          pointer to buffer for the received mail pointer.
+/// \param[out]    msg_prio      pointer to buffer for mail priority or NULL.
+/// \param[in]     timeout       \ref CMSIS_RTOS_TimeOutValue or 0 in case of no time-out.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osMailQueueGet (osMailQueueId_t mq_id, void **mail, uint8_t *msg_prio, uint32_t timeout);
+
+/// Return a received (or unsent) mail to its Mail Queue.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \param[in]     mail          mail obtained by \ref osMailQueueGet or \ref osMailQueueAlloc.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osMailQueueFree (osMailQueueId_t mq_id, void *mail);
+
+/// Get number of queued mails in a Mail Queue.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \return number of queued mails.
+uint32_t osMailQueueGetCount (osMailQueueId_t mq_id);
+
+/// Get the size of a mail's block in a Mail Queue (extension).
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \return size of a mail block in bytes or 0 in case of error.
+uint32_t osMailQueueGetMailSize (osMailQueueId_t mq_id);
+
+/// Delete a Mail Queue object.
+/// \param[in]     mq_id         mail queue ID obtained by \ref osMailQueueNew.
+/// \return status code that indicates the execution status of the function.
+osStatus_t osMailQueueDelete (osMailQueueId_t mq_id);
+
+
 #ifdef  __cplusplus
 }
 #endif
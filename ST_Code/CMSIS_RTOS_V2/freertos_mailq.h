@@ -0,0 +1,53 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    freertos_mailq.h
+ *      Purpose: CMSIS RTOS2 wrapper for FreeRTOS
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef FREERTOS_MAILQ_H_
+#define FREERTOS_MAILQ_H_
+
+#include <stdint.h>
+#include "freertos_mpool.h"
+#include "freertos_mqueue.h"
+
+/* Mail Queue implementation definitions */
+#define MAILQ_STATUS              0x5EEF0000U
+
+/* Mail Queue control block: mail is allocated from the pool and only the
+   block pointer travels through the message queue */
+typedef struct MailQueueDef_t {
+  MemPool_t          mp;        /* Mail block pool                    */
+  MessageQueue_t     mq;        /* Queue of mail block pointers       */
+  volatile uint32_t  status;    /* Object status flags                */
+} MailQueue_t;
+
+/* No need to hide static object type, just align to coding style */
+#define StaticMailQueue_t       MailQueue_t
+
+/* Define mail queue control block size */
+#define MAILQ_CB_SIZE           (sizeof(StaticMailQueue_t))
+
+/* Define size of the byte array required for count of mails of given size */
+#define MAILQ_MP_SIZE(mail_count, mail_size) MEMPOOL_ARR_SIZE(mail_count, mail_size)
+
+/* Define size of the byte array required to queue count of mails */
+#define MAILQ_MQ_SIZE(mail_count) MQUEUE_ARR_SIZE(mail_count, sizeof(void *))
+
+#endif /* FREERTOS_MAILQ_H_ */
@@ -30,24 +30,40 @@
 /* Memory Pool implementation definitions */
 #define MPOOL_STATUS              0x5EED0000U
 
+/* Free list end marker */
+#define MPOOL_NONE                0xFFFFU
+
+/* The free list head word holds the index of the first free block in bits
+   0..15 and a tag in bits 16..31. Every push and pop bumps the tag, so a
+   compare-and-swap made with a stale head fails even when the same block
+   is back on top of the list (ABA). */
+#define MPOOL_HEAD_INDEX(head)    ((head) & 0xFFFFU)
+#define MPOOL_HEAD_TAG_INC        0x10000U
+
 /* Memory Block header */
 typedef struct {
-  void *next;                   /* Pointer to next block  */
+  uint32_t next;                /* Index of next free block */
 } MemPoolBlock_t;
 
-/* Memory Pool control block */
+/* Memory Pool control block. Freed blocks go on the 'head' list. With
+   configOS2_MPOOL_PREZERO, the idle task moves them to the 'clean' list
+   once it has zeroed them. */
 typedef struct MemPoolDef_t {
-  MemPoolBlock_t    *head;      /* Pointer to head block   */
-  SemaphoreHandle_t  sem;       /* Pool semaphore handle   */
-  uint8_t           *mem_arr;   /* Pool memory array       */
-  uint32_t           mem_sz;    /* Pool memory array size  */
-  const char        *name;      /* Pointer to name string  */
-  uint32_t           bl_sz;     /* Size of a single block  */
-  uint32_t           bl_cnt;    /* Number of blocks        */
-  uint32_t           n;         /* Block allocation index  */
-  volatile uint32_t  status;    /* Object status flags     */
+  volatile uint32_t  head;      /* Free list head: tag and block index */
+  volatile uint32_t  clean;     /* Zeroed free list head, same format  */
+  SemaphoreHandle_t  sem;       /* Wakes threads blocked in alloc      */
+  uint8_t           *mem_arr;   /* Pool memory array                   */
+  uint32_t           mem_sz;    /* Pool memory array size              */
+  const char        *name;      /* Pointer to name string              */
+  uint32_t           bl_sz;     /* Size of a single block              */
+  uint32_t           bl_cnt;    /* Number of blocks                    */
+  volatile uint32_t  n;         /* Block allocation index              */
+  volatile uint32_t  used;      /* Number of blocks allocated          */
+  volatile uint32_t  waiters;   /* Number of threads blocked in alloc  */
+  volatile uint32_t  status;    /* Object status flags                 */
+  struct MemPoolDef_t *next;    /* Next pool zeroed by the idle task   */
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
-  StaticSemaphore_t  mem_sem;   /* Semaphore object memory */
+  StaticSemaphore_t  mem_sem;   /* Semaphore object memory             */
 #endif
 } MemPool_t;
 
@@ -57,7 +73,10 @@ typedef struct MemPoolDef_t {
 /* Define memory pool control block size */
 #define MEMPOOL_CB_SIZE         (sizeof(StaticMemPool_t))
 
+/* Define distance between blocks of given size */
+#define MEMPOOL_BLOCK_STRIDE(bl_size) ((((bl_size) + (4 - 1)) / 4) * 4)
+
 /* Define size of the byte array required to create count of blocks of given size */
-#define MEMPOOL_ARR_SIZE(bl_count, bl_size) (((((bl_size) + (4 - 1)) / 4) * 4)*(bl_count))
+#define MEMPOOL_ARR_SIZE(bl_count, bl_size) (MEMPOOL_BLOCK_STRIDE(bl_size) * (bl_count))
 
 #endif /* FREERTOS_MPOOL_H_ */
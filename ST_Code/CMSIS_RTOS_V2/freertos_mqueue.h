@@ -0,0 +1,84 @@
+/* --------------------------------------------------------------------------
+ * Copyright (c) 2013-2020 Arm Limited. All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *      Name:    freertos_mqueue.h
+ *      Purpose: CMSIS RTOS2 wrapper for FreeRTOS
+ *
+ *---------------------------------------------------------------------------*/
+
+#ifndef FREERTOS_MQUEUE_H_
+#define FREERTOS_MQUEUE_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/* Message Queue implementation definitions */
+#define MQUEUE_STATUS             0x5EEE0000U
+
+/* Messages are ordered by msg_prio 0..255, highest first, and messages of
+   equal priority in FIFO order. Each priority has its own list, kept
+   circular through its tail slot so that a priority costs one index. A map
+   of MQUEUE_PRIO_WORDS words has one bit per non-empty priority, and a
+   summary word one bit per non-zero map word, so the highest priority
+   waiting is found with two CLZs. */
+#define MQUEUE_PRIO_LEVELS        256U
+#define MQUEUE_PRIO_WORDS         (MQUEUE_PRIO_LEVELS / 32U)
+
+/* End of list marker */
+#define MQUEUE_NONE               0xFFFFU
+
+/* Message slot header, followed by the message data */
+typedef struct {
+  uint16_t next;                /* Index of next slot in the same list */
+  uint8_t  prio;                /* Message priority as put             */
+  uint8_t  reserved;
+} MessageQueueSlot_t;
+
+/* Message Queue control block */
+typedef struct MessageQueueDef_t {
+  SemaphoreHandle_t  sem_free;  /* Free slot count semaphore handle   */
+  SemaphoreHandle_t  sem_msg;   /* Queued message semaphore handle    */
+  uint8_t           *mem_arr;   /* Slot memory array                  */
+  const char        *name;      /* Pointer to name string             */
+  uint32_t           msg_sz;    /* Size of a single message           */
+  uint32_t           msg_cnt;   /* Number of slots                    */
+  uint32_t           slot_sz;   /* Slot size: header plus message     */
+  uint32_t           summary;   /* Bit n set if map[n] is not zero    */
+  uint32_t           map[MQUEUE_PRIO_WORDS]; /* Bit set per non-empty priority */
+  uint16_t           free;      /* First free slot                    */
+  uint16_t           tail[MQUEUE_PRIO_LEVELS]; /* Newest slot per priority */
+  volatile uint32_t  status;    /* Object status flags                */
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  StaticSemaphore_t  mem_sem_free; /* Semaphore object memory         */
+  StaticSemaphore_t  mem_sem_msg;  /* Semaphore object memory         */
+#endif
+} MessageQueue_t;
+
+/* No need to hide static object type, just align to coding style */
+#define StaticMessageQueue_t    MessageQueue_t
+
+/* Define message queue control block size */
+#define MQUEUE_CB_SIZE          (sizeof(StaticMessageQueue_t))
+
+/* Define size of a slot holding a message of given size */
+#define MQUEUE_SLOT_SIZE(msg_size) (sizeof(MessageQueueSlot_t) + ((((msg_size) + (4 - 1)) / 4) * 4))
+
+/* Define size of the byte array required to create count of messages of given size */
+#define MQUEUE_ARR_SIZE(msg_count, msg_size) (MQUEUE_SLOT_SIZE(msg_size) * (msg_count))
+
+#endif /* FREERTOS_MQUEUE_H_ */
@@ -55,6 +55,18 @@
 #define configUSE_OS2_THREAD_ENUMERATE        1
 #endif
 
+/*
+  Number of threads recorded in the thread registry used by osThreadEnumerate
+  and osThreadEnumerateNext to list threads without allocating memory. The
+  registry is filled from the FreeRTOS task trace hooks, so FreeRTOSConfig.h
+  must define traceTASK_CREATE(pxNewTCB) as vOS2TraceTaskCreate(pxNewTCB) and
+  traceTASK_DELETE(pxTCB) as vOS2TraceTaskDelete(pxTCB). While more threads
+  exist than fit, osThreadEnumerate falls back to a heap allocated snapshot.
+*/
+#ifndef configOS2_THREAD_REGISTRY_SIZE
+#define configOS2_THREAD_REGISTRY_SIZE        16
+#endif
+
 /*
   Option to disable CMSIS-RTOS2 function osEventFlagsSet and osEventFlagsClear
   operation from ISR.
@@ -63,6 +75,20 @@
 #define configUSE_OS2_EVENTFLAGS_FROM_ISR     1
 #endif
 
+/*
+  Option to keep CMSIS-RTOS2 event flags in the wrapper instead of FreeRTOS
+  event groups. osEventFlagsSet then wakes waiting threads itself, also when
+  called from an ISR, instead of deferring the work to the timer daemon task.
+  Waiting threads block on task notification index 1.
+  osEventFlagsSet checks every waiter of the object inside one critical
+  section, so from an ISR interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY
+  stay masked for time that grows with the number of threads waiting on it.
+  Keep the waiters of objects set from ISRs few, or set this option to 0.
+*/
+#ifndef configOS2_EVENTFLAGS_DIRECT
+#define configOS2_EVENTFLAGS_DIRECT           1
+#endif
+
 /*
   Option to exclude CMSIS-RTOS2 Thread Flags API functions from the application image.
 */
@@ -84,6 +110,61 @@
 #define configUSE_OS2_MUTEX                   configUSE_MUTEXES
 #endif
 
+/*
+  Number of control blocks of each kind held in static slabs. Objects created
+  without cb_mem take their control block from the matching slab and only use
+  the FreeRTOS heap once it is full. Set a count to 0 to disable a slab.
+  Thread slabs hold the TCB only: thread stacks still come from the heap. They
+  are released by vOS2CleanUpTCB, so FreeRTOSConfig.h must define
+  portCLEAN_UP_TCB(pxTCB) as vOS2CleanUpTCB(pxTCB) when the thread slab is used.
+*/
+#ifndef configOS2_SLAB_THREAD_COUNT
+#define configOS2_SLAB_THREAD_COUNT           4
+#endif
+
+#ifndef configOS2_SLAB_TIMER_COUNT
+#define configOS2_SLAB_TIMER_COUNT            4
+#endif
+
+#ifndef configOS2_SLAB_EVENTFLAGS_COUNT
+#define configOS2_SLAB_EVENTFLAGS_COUNT       4
+#endif
+
+#ifndef configOS2_SLAB_SEMAPHORE_COUNT
+#define configOS2_SLAB_SEMAPHORE_COUNT        8
+#endif
+
+#ifndef configOS2_SLAB_MQUEUE_COUNT
+#define configOS2_SLAB_MQUEUE_COUNT           2
+#endif
+
+#ifndef configOS2_SLAB_MPOOL_COUNT
+#define configOS2_SLAB_MPOOL_COUNT            2
+#endif
+
+#ifndef configOS2_SLAB_MAILQ_COUNT
+#define configOS2_SLAB_MAILQ_COUNT            2
+#endif
+
+/*
+  Option to zero freed memory pool blocks while the system is idle. It needs
+  configUSE_IDLE_HOOK 1: the wrapper's default vApplicationIdleHook calls
+  osMemoryPoolZeroIdle, and an application that provides its own hook must
+  call osMemoryPoolZeroIdle from it. Each call zeroes one freed
+  block and moves it to its pool's list of clean blocks, which
+  osMemoryPoolCAlloc and osMailQueueCAlloc hand out without clearing them.
+  A block is out of its pool while it is zeroed, so an allocation that does
+  not wait may find the pool empty meanwhile. The CMSIS-RTOS v1 name of the
+  option, configOS1_POOL_PREZERO, is also accepted.
+*/
+#ifndef configOS2_MPOOL_PREZERO
+  #ifdef configOS1_POOL_PREZERO
+    #define configOS2_MPOOL_PREZERO           configOS1_POOL_PREZERO
+  #else
+    #define configOS2_MPOOL_PREZERO           0
+  #endif
+#endif
+
 
 /*
   CMSIS-RTOS2 FreeRTOS configuration check (FreeRTOSConfig.h).
@@ -204,10 +285,24 @@
     from the ISR their operation from ISR can be restricted by setting:
     #define configUSE_OS2_EVENTFLAGS_FROM_ISR 0 (in FreeRTOSConfig.h)
   */
-  #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 1)
+  #if (configUSE_OS2_EVENTFLAGS_FROM_ISR == 1) && (configOS2_EVENTFLAGS_DIRECT == 0)
     #error "Definition INCLUDE_xTimerPendFunctionCall must equal 1 to implement Event Flags API."
   #endif
 #endif
+#if (INCLUDE_xTimerPendFunctionCall == 0)
+  /*
+    CMSIS-RTOS2 function osTimerDelete returns a timer's slab slot by queuing
+    a function call to the timer service task with xTimerPendFunctionCall.
+    Set #define INCLUDE_xTimerPendFunctionCall 1 to fix this error.
+
+    Alternatively, timer control blocks can be taken from the heap instead
+    of the timer slab by setting:
+    #define configOS2_SLAB_TIMER_COUNT 0 (in FreeRTOSConfig.h)
+  */
+  #if (configUSE_OS2_TIMER == 1) && (configOS2_SLAB_TIMER_COUNT > 0)
+    #error "Definition INCLUDE_xTimerPendFunctionCall must equal 1 to implement Timer Management API."
+  #endif
+#endif
 
 #if (configUSE_TIMERS == 0)
   /*
@@ -266,6 +361,36 @@
   #endif
 #endif
 
+#if (configTASK_NOTIFICATION_ARRAY_ENTRIES < 3)
+  /*
+    CMSIS-RTOS2 Thread Flags API functions use three task notifications per thread:
+    one holds the thread flags, one holds the condition a waiting thread waits for
+    and the thread blocks on the third, so it is only woken once that condition is met.
+    Set #define configTASK_NOTIFICATION_ARRAY_ENTRIES 3 to fix this error.
+
+    Alternatively, if the application does not use thread flags functions they can be
+    excluded from the image code by setting:
+    #define configUSE_OS2_THREAD_FLAGS 0 (in FreeRTOSConfig.h)
+  */
+  #if (configUSE_OS2_THREAD_FLAGS == 1)
+    #error "Definition configTASK_NOTIFICATION_ARRAY_ENTRIES must be at least 3 to implement Thread Flags API."
+  #endif
+#endif
+
+#if (configTASK_NOTIFICATION_ARRAY_ENTRIES < 2)
+  /*
+    CMSIS-RTOS2 Event Flags API functions kept in the wrapper block waiting threads
+    on task notification index 1.
+    Set #define configTASK_NOTIFICATION_ARRAY_ENTRIES 2 to fix this error.
+
+    Alternatively, event flags can be implemented with FreeRTOS event groups by setting:
+    #define configOS2_EVENTFLAGS_DIRECT 0 (in FreeRTOSConfig.h)
+  */
+  #if (configOS2_EVENTFLAGS_DIRECT == 1)
+    #error "Definition configTASK_NOTIFICATION_ARRAY_ENTRIES must be at least 2 to implement Event Flags API."
+  #endif
+#endif
+
 #if (configUSE_TRACE_FACILITY == 0)
   /*
     CMSIS-RTOS2 function osThreadEnumerate requires FreeRTOS function uxTaskGetSystemState
@@ -281,6 +406,18 @@
   #endif
 #endif
 
+#if (configOS2_MPOOL_PREZERO == 1)
+  /*
+    CMSIS-RTOS2 zeroes freed memory pool blocks from the idle hook, which is
+    only called if configUSE_IDLE_HOOK == 1.
+    Set #define configUSE_IDLE_HOOK 1 to fix this error, or set
+    #define configOS2_MPOOL_PREZERO 0 (in FreeRTOSConfig.h)
+  */
+  #if (configUSE_IDLE_HOOK == 0)
+    #error "Definition configUSE_IDLE_HOOK must equal 1 to zero memory pool blocks while idle."
+  #endif
+#endif
+
 #if (configUSE_16_BIT_TICKS == 1)
   /*
     CMSIS-RTOS2 wrapper for FreeRTOS relies on 32-bit tick timer which is also optimal on
@@ -0,0 +1,47 @@
+#
+# Microvisor FreeRTOS Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Report the flash and RAM taken by the CMSIS-RTOS wrappers: the standalone
+# v1 wrapper linked beside the RTOS2 wrapper, as a mixed application used to
+# be built, against the RTOS2 wrapper with the v1 layer on top. Run via the
+# `cmsis_layer_sizes` target, which sets BINARY_DIR and SIZE.
+#
+
+# Sizes of one wrapper's object file, before the linker drops unused functions
+function(object_size SOURCE FLASH_VAR RAM_VAR)
+    file(GLOB_RECURSE OBJECT "${BINARY_DIR}/CMakeFiles/*/ST_Code/${SOURCE}.o*")
+    if(NOT OBJECT)
+        message(FATAL_ERROR "No object file for ${SOURCE}")
+    endif()
+
+    # Berkeley format: text data bss dec hex filename
+    execute_process(
+        COMMAND ${SIZE} --format=berkeley ${OBJECT}
+        OUTPUT_VARIABLE SIZE_OUTPUT
+    )
+    string(REGEX MATCH "\n[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)" _ "${SIZE_OUTPUT}")
+    math(EXPR FLASH "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+    math(EXPR RAM "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+    message("${SOURCE}:\tflash ${FLASH} B\tRAM ${RAM} B")
+
+    set(${FLASH_VAR} ${FLASH} PARENT_SCOPE)
+    set(${RAM_VAR} ${RAM} PARENT_SCOPE)
+endfunction()
+
+object_size(CMSIS_RTOS_V2/cmsis_os2.c OS2_FLASH OS2_RAM)
+object_size(CMSIS_RTOS/cmsis_os.c OS1_FLASH OS1_RAM)
+object_size(CMSIS_RTOS_V2/cmsis_os1.c LAYER_FLASH LAYER_RAM)
+
+math(EXPR SEPARATE_FLASH "${OS2_FLASH} + ${OS1_FLASH}")
+math(EXPR SEPARATE_RAM "${OS2_RAM} + ${OS1_RAM}")
+math(EXPR LAYERED_FLASH "${OS2_FLASH} + ${LAYER_FLASH}")
+math(EXPR LAYERED_RAM "${OS2_RAM} + ${LAYER_RAM}")
+math(EXPR FLASH_SAVED "${SEPARATE_FLASH} - ${LAYERED_FLASH}")
+math(EXPR RAM_SAVED "${SEPARATE_RAM} - ${LAYERED_RAM}")
+
+message("v1 and RTOS2 wrappers side by side:\tflash ${SEPARATE_FLASH} B\tRAM ${SEPARATE_RAM} B")
+message("v1 layer over the RTOS2 wrapper:\tflash ${LAYERED_FLASH} B (saves ${FLASH_SAVED} B)\tRAM ${LAYERED_RAM} B (saves ${RAM_SAVED} B)")
+message("For per-call cycle costs through each API, build with ENABLE_BENCHMARKS and see the [BENCH] v1/v2 lines")
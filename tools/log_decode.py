@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# Microvisor FreeRTOS Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+"""Decode deferred log records.
+
+With LOG_DEFERRED_FORMAT set, the device sends each server_log() call as a
+'#'-prefixed base64 record holding a format string ID and the raw argument
+values. This tool looks the format strings up in the .log_fmt section of the
+application .elf and prints the reconstructed lines. Lines that are not
+records are passed through unchanged, so a whole log stream capture can be
+piped in:
+
+    twilio microvisor:logs:stream ${MV_DEVICE_SID} | \\
+        tools/log_decode.py build/Demo/mv-freertos-cmsis-demo.elf
+
+Records are timestamped with the device's 64-bit cycle count; pass the
+core clock with --core-clock if it is not the default 160MHz.
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+
+
+FORMAT_SECTION = ".log_fmt"
+RECORD_MARKER = "#"
+RECORD_PATTERN = re.compile(re.escape(RECORD_MARKER) + r"([A-Za-z0-9+/]+)\s*$")
+FLAG_ERROR = 0x01
+FLAG_TRUNCATED = 0x02
+FLAG_TIMESTAMP = 0x04
+FLAG_ISR = 0x08
+FLAG_SUMMARY = 0x10
+DEFAULT_CORE_CLOCK_HZ = 160000000
+
+# printf conversion: flags, width, precision, length, conversion
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGcsp%])")
+
+
+class Truncated(Exception):
+    pass
+
+
+def load_format_strings(elf_path):
+    """Return the .log_fmt section's load address and contents."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit(f"{elf_path} is not a 32-bit ELF file")
+
+    endian = "<" if elf[5] == 1 else ">"
+    e_shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+
+    def section(index):
+        return struct.unpack_from(endian + "IIIIIIIIII", elf, e_shoff + index * e_shentsize)
+
+    names_offset = section(e_shstrndx)[4]
+    for index in range(e_shnum):
+        sh_name, _, _, sh_addr, sh_offset, sh_size = section(index)[:6]
+        name_end = elf.index(b"\0", names_offset + sh_name)
+        if elf[names_offset + sh_name:name_end].decode() == FORMAT_SECTION:
+            return sh_addr, elf[sh_offset:sh_offset + sh_size]
+
+    sys.exit(f"{elf_path} has no {FORMAT_SECTION} section -- was it built with LOG_DEFERRED_FORMAT?")
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise Truncated()
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte & 0x80 == 0:
+                return value
+
+    def raw(self, length):
+        if self.pos + length > len(self.data):
+            raise Truncated()
+        value = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return value
+
+
+def signed(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def render(format_string, reader):
+    """Rebuild the message text, consuming one encoded value per argument."""
+    out = []
+    last = 0
+    for match in CONVERSION.finditer(format_string):
+        out.append(format_string[last:match.start()])
+        last = match.end()
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            out.append("%")
+            continue
+
+        try:
+            if width == "*":
+                width = str(signed(reader.varint(), 32))
+            if precision == "*":
+                precision = str(signed(reader.varint(), 32))
+
+            if conversion == "s":
+                value = reader.raw(reader.varint()).decode("utf-8", "replace")
+            elif conversion in "eEfFgG":
+                value, = struct.unpack("<d", reader.raw(8))
+            else:
+                bits = 64 if length in ("ll", "j") else 32
+                value = reader.varint()
+                if conversion in "di":
+                    value = signed(value, bits)
+                elif conversion == "c":
+                    value = chr(value & 0xFF)
+                elif conversion == "p":
+                    value, conversion, flags = value, "x", flags + "#"
+                conversion = {"u": "d", "i": "d"}.get(conversion, conversion)
+        except Truncated:
+            out.append("<?>")
+            continue
+
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "") + conversion
+        out.append(spec % value)
+
+    out.append(format_string[last:])
+    return "".join(out)
+
+
+def format_timestamp(cycles, core_clock_hz):
+    """Match the device's text mode timestamp prefix: seconds.microseconds."""
+    us = cycles // max(core_clock_hz // 1000000, 1)
+    return f"[{us // 1000000}.{us % 1000000:06d}] "
+
+
+def decode_record(encoded, section_addr, section, core_clock_hz):
+    data = base64.b64decode(encoded + "=" * (-len(encoded) % 4))
+    reader = Reader(data)
+    flags = reader.raw(1)[0]
+    offset = reader.varint() - section_addr
+    if offset < 0 or offset >= len(section):
+        return f"<unknown log message ID 0x{offset + section_addr:x}>"
+
+    format_string = section[offset:section.index(b"\0", offset)].decode("utf-8", "replace")
+    prefix = ""
+    if flags & FLAG_TIMESTAMP:
+        prefix = format_timestamp(reader.varint(), core_clock_hz)
+    if flags & FLAG_ISR:
+        prefix += "[ISR] "
+
+    if flags & FLAG_SUMMARY:
+        repeats, rate_limited = reader.varint(), reader.varint()
+        text = f"Last message repeated {repeats} times, {rate_limited} more rate limited: {format_string}"
+    else:
+        text = render(format_string, reader)
+    if flags & FLAG_ERROR:
+        text = "[ERROR] " + text
+    text = prefix + text
+    if flags & FLAG_TRUNCATED:
+        text += " [TRUNCATED]"
+    return text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode deferred Microvisor log records.")
+    parser.add_argument("elf", help="application .elf the device is running")
+    parser.add_argument("capture", nargs="?", help="captured log output (default: stdin)")
+    parser.add_argument("--core-clock", type=int, default=DEFAULT_CORE_CLOCK_HZ,
+                        help=f"device core clock in Hz (default: {DEFAULT_CORE_CLOCK_HZ})")
+    args = parser.parse_args()
+
+    section_addr, section = load_format_strings(args.elf)
+    capture = open(args.capture, encoding="utf-8", errors="replace") if args.capture else sys.stdin
+
+    for line in capture:
+        line = line.rstrip("\r\n")
+        match = RECORD_PATTERN.search(line)
+        if match is None:
+            print(line)
+            continue
+
+        try:
+            text = decode_record(match.group(1), section_addr, section, args.core_clock)
+        except (ValueError, Truncated):
+            print(line)
+            continue
+        print(line[:match.start()] + text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+/*
+ *
+ * Microvisor FreeRTOS Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+
+/*
+ * Host benchmark: log_vformat() vs. the C library's vsnprintf(), over
+ * messages like the ones the demo logs. Run it with tools/log_format_bench.sh.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log_format.h"
+
+
+/*
+ * PRIVATE DEFINITIONS
+ */
+#define     BENCH_ITERATIONS            1000000
+#define     BENCH_BUFFER_SIZE_B         128
+
+
+/*
+ * PRIVATE TYPES
+ */
+typedef uint32_t (*formatter_t)(char* buffer, uint32_t size, const char* format_string, va_list args);
+
+
+/*
+ * PRIVATE FUNCTION PROTOTYPES
+ */
+static uint32_t call_vsnprintf(char* buffer, uint32_t size, const char* format_string, va_list args);
+static uint32_t format(formatter_t formatter, char* buffer, const char* format_string, ...);
+static uint32_t format_message(formatter_t formatter, char* buffer, uint32_t message, uint32_t i);
+static double   run(formatter_t formatter, uint32_t message);
+static double   now_ns(void);
+
+
+/*
+ * GLOBALS
+ */
+static const char* const messages[] = {
+    "Ping %u",
+    "App: %s %s (BUILD %i)",
+    "[ISR P%lu @%lu] Timer %08x",
+    "[BENCH] %s: min %lu avg %lu max %lu cycles (n=%lu)"
+};
+static volatile uint32_t sink;
+
+
+int main(void) {
+
+    char ours[BENCH_BUFFER_SIZE_B], theirs[BENCH_BUFFER_SIZE_B];
+    uint32_t failures = 0;
+
+    printf("%-52s %12s %12s %8s\n", "message", "log_vformat", "vsnprintf", "speedup");
+
+    for (uint32_t i = 0 ; i < sizeof(messages) / sizeof(messages[0]) ; ++i) {
+        // Check the two agree before timing them
+        format_message(log_vformat, ours, i, 0xbeef);
+        format_message(call_vsnprintf, theirs, i, 0xbeef);
+        if (strcmp(ours, theirs) != 0) {
+            printf("MISMATCH: \"%s\" vs \"%s\"\n", ours, theirs);
+            failures++;
+        }
+
+        double ours_ns = run(log_vformat, i);
+        double theirs_ns = run(call_vsnprintf, i);
+        printf("%-52s %9.1f ns %9.1f ns %7.2fx\n", messages[i], ours_ns, theirs_ns, theirs_ns / ours_ns);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+
+/**
+ * @brief Adapt vsnprintf() to the log_vformat() signature.
+ */
+static uint32_t call_vsnprintf(char* buffer, uint32_t size, const char* format_string, va_list args) {
+
+    int length = vsnprintf(buffer, size, format_string, args);
+    return (length < 0) ? 0 : (uint32_t)length;
+}
+
+
+/**
+ * @brief Format a message with the given formatter.
+ */
+static uint32_t format(formatter_t formatter, char* buffer, const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    uint32_t length = formatter(buffer, BENCH_BUFFER_SIZE_B, format_string, args);
+    va_end(args);
+    return length;
+}
+
+
+/**
+ * @brief Format one of the benchmark messages.
+ *
+ * @param formatter The formatter to use.
+ * @param buffer    The output buffer.
+ * @param message   Index into `messages`.
+ * @param i         A value to vary the output.
+ *
+ * @retval The message length.
+ */
+static uint32_t format_message(formatter_t formatter, char* buffer, uint32_t message, uint32_t i) {
+
+    switch (message) {
+        case 0:
+            return format(formatter, buffer, messages[0], i);
+        case 1:
+            return format(formatter, buffer, messages[1], "Microvisor FreeRTOS Demo", "1.0.2", (int)i);
+        case 2:
+            return format(formatter, buffer, messages[2], (unsigned long)6, (unsigned long)i, i);
+        default:
+            return format(formatter, buffer, messages[3], "server_log (in place)",
+                          (unsigned long)i, (unsigned long)(i * 3), (unsigned long)(i * 7), (unsigned long)32);
+    }
+}
+
+
+/**
+ * @brief Time one message with one formatter.
+ *
+ * @retval Average time per call in nanoseconds.
+ */
+static double run(formatter_t formatter, uint32_t message) {
+
+    char buffer[BENCH_BUFFER_SIZE_B];
+    double start = now_ns();
+
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {
+        sink += format_message(formatter, buffer, message, i);
+    }
+
+    return (now_ns() - start) / BENCH_ITERATIONS;
+}
+
+
+/**
+ * @brief Read a monotonic clock.
+ */
+static double now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
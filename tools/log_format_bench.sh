@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+#
+# Microvisor FreeRTOS Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Compare the in-tree log formatter with the C library's vsnprintf():
+#   1. Throughput, on the host
+#   2. Code size and stack use on the device, against newlib-nano, if
+#      arm-none-eabi-gcc is installed
+#
+set -e
+
+REPO_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+CC="${CC:-cc}"
+ARM_CC="arm-none-eabi-gcc"
+ARM_FLAGS="-mcpu=cortex-m33 -mthumb -mfloat-abi=soft -Os -ffunction-sections -fdata-sections"
+
+echo "Throughput (host, ${CC}):"
+"${CC}" -O2 -std=gnu11 -I"${REPO_DIR}/Demo/Inc" \
+    "${REPO_DIR}/tools/log_format_bench.c" "${REPO_DIR}/Demo/Src/log_format.c" \
+    -o "${WORK_DIR}/bench"
+"${WORK_DIR}/bench"
+
+if ! command -v "${ARM_CC}" > /dev/null; then
+    echo "${ARM_CC} not found: skipping the device size comparison"
+    exit 0
+fi
+
+# Two minimal images that differ only in the formatter they call
+cat > "${WORK_DIR}/use_vsnprintf.c" << 'END'
+#include <stdarg.h>
+#include <stdio.h>
+int format(char* b, unsigned s, const char* f, va_list a) { return vsnprintf(b, s, f, a); }
+END
+cat > "${WORK_DIR}/use_log_vformat.c" << 'END'
+#include "log_format.h"
+int format(char* b, unsigned s, const char* f, va_list a) { return (int)log_vformat(b, s, f, a); }
+END
+cat > "${WORK_DIR}/main.c" << 'END'
+#include <stdarg.h>
+extern int format(char* b, unsigned s, const char* f, va_list a);
+static int call(char* b, const char* f, ...) { va_list a; va_start(a, f); int n = format(b, 64, f, a); va_end(a); return n; }
+int main(void) { char b[64]; return call(b, "Ping %u", 1U); }
+END
+
+echo
+echo "Device code size (newlib-nano, ${ARM_FLAGS}):"
+for variant in vsnprintf log_vformat; do
+    sources="${WORK_DIR}/main.c ${WORK_DIR}/use_${variant}.c"
+    [ "${variant}" = "log_vformat" ] && sources="${sources} ${REPO_DIR}/Demo/Src/log_format.c"
+    ${ARM_CC} ${ARM_FLAGS} -I"${REPO_DIR}/Demo/Inc" --specs=nano.specs --specs=nosys.specs \
+        -Wl,--gc-sections ${sources} -o "${WORK_DIR}/${variant}.elf"
+    text=$(arm-none-eabi-size "${WORK_DIR}/${variant}.elf" | awk 'NR == 2 { print $1 }')
+    printf "  %-12s %6s bytes of .text\n" "${variant}" "${text}"
+done
+
+echo
+echo "Device stack use (-fstack-usage):"
+${ARM_CC} ${ARM_FLAGS} -fstack-usage -I"${REPO_DIR}/Demo/Inc" \
+    -c "${REPO_DIR}/Demo/Src/log_format.c" -o "${WORK_DIR}/log_format.o"
+sed 's/^/  /' "${WORK_DIR}/log_format.su"
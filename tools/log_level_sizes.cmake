@@ -0,0 +1,53 @@
+#
+# Microvisor FreeRTOS Demo
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# Build the application at each log level and report its size relative to
+# a TRACE build. Run via the `log_level_sizes` target, which sets
+# SOURCE_DIR, BINARY_DIR, ELF_NAME and SIZE.
+#
+
+set(LEVELS TRACE DEBUG INFO WARN ERROR NONE)
+
+foreach(LEVEL ${LEVELS})
+    set(LEVEL_DIR "${BINARY_DIR}/${LEVEL}")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${LEVEL_DIR}" -DLOG_LEVEL=${LEVEL}
+        OUTPUT_QUIET
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Could not configure the ${LEVEL} build")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} --build "${LEVEL_DIR}"
+        OUTPUT_QUIET
+        RESULT_VARIABLE RESULT
+    )
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Could not build the ${LEVEL} build")
+    endif()
+
+    # Berkeley format: text data bss dec hex filename
+    execute_process(
+        COMMAND ${SIZE} --format=berkeley "${LEVEL_DIR}/Demo/${ELF_NAME}"
+        OUTPUT_VARIABLE SIZE_OUTPUT
+    )
+    string(REGEX MATCH "\n[ \t]*([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)" _ "${SIZE_OUTPUT}")
+    math(EXPR FLASH "${CMAKE_MATCH_1} + ${CMAKE_MATCH_2}")
+    math(EXPR RAM "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+
+    if(NOT DEFINED BASE_FLASH)
+        set(BASE_FLASH ${FLASH})
+        set(BASE_RAM ${RAM})
+    endif()
+
+    math(EXPR FLASH_SAVED "${BASE_FLASH} - ${FLASH}")
+    math(EXPR RAM_SAVED "${BASE_RAM} - ${RAM}")
+    message("${LEVEL}:\tflash ${FLASH} B (saves ${FLASH_SAVED} B)\tRAM ${RAM} B (saves ${RAM_SAVED} B)")
+endforeach()
+
+message("For per-call cycle costs, build with ENABLE_BENCHMARKS and see the [BENCH] log_* lines")